@@ -0,0 +1,151 @@
+// ext/games_dice/core/bench_probability_list.c
+
+// Native benchmark for the distribution kernels, run with "make bench". Useful with perf, or to
+// compare changes to the kernels without Ruby overhead.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "probability_list.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now() {
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static ProbabilityList *fair_die( int sides ) {
+  ProbabilityList *pl = NULL;
+  if ( new_basic_pl( sides, 1.0 / sides, 1, &pl ) != GD_OK ) {
+    fprintf( stderr, "Could not create d%d\n", sides );
+    exit( 1 );
+  }
+  return pl;
+}
+
+static void report( const char *label, int reps, double start ) {
+  double elapsed = now() - start;
+  printf( "%-40s %8d reps %12.3f us/rep\n", label, reps, 1e6 * elapsed / reps );
+}
+
+static void bench_repeat_sum( int sides, int n, int reps, int reuse ) {
+  char label[64];
+  ProbabilityList *die = fair_die( sides );
+  ProbabilityList *pl;
+  double start = now();
+  int i;
+  for ( i = 0; i < reps; i++ ) {
+    if ( ! reuse ) {
+      destroy_probability_list( die );
+      die = fair_die( sides );
+    }
+    pl_repeat_sum( die, n, &pl );
+    destroy_probability_list( pl );
+  }
+  snprintf( label, sizeof(label), "repeat_sum d%d x %d%s", sides, n, reuse ? " (cached)" : "" );
+  report( label, reps, start );
+  destroy_probability_list( die );
+}
+
+static void bench_repeat_n_sum_k( int sides, int n, int k, int reps ) {
+  char label[64];
+  ProbabilityList *die = fair_die( sides );
+  ProbabilityList *pl;
+  double start = now();
+  int i;
+  for ( i = 0; i < reps; i++ ) {
+    pl_repeat_n_sum_k( die, n, k, 1, &pl );
+    destroy_probability_list( pl );
+  }
+  snprintf( label, sizeof(label), "repeat_n_sum_k d%d %d keep %d", sides, n, k );
+  report( label, reps, start );
+  destroy_probability_list( die );
+}
+
+static void bench_multiplied( int mult, int sides_a, int sides_b, int reps ) {
+  char label[64];
+  ProbabilityList *die_a = fair_die( sides_a );
+  ProbabilityList *die_b = fair_die( sides_b );
+  ProbabilityList *pl_mult, *pl;
+  double start = now();
+  int i;
+  for ( i = 0; i < reps; i++ ) {
+    pl_add_distributions_mult( mult, die_a, 0, die_a, &pl_mult );
+    pl_add_distributions( pl_mult, die_b, &pl );
+    destroy_probability_list( pl );
+    destroy_probability_list( pl_mult );
+  }
+  snprintf( label, sizeof(label), "%d x d%d + d%d", mult, sides_a, sides_b );
+  report( label, reps, start );
+  destroy_probability_list( die_a );
+  destroy_probability_list( die_b );
+}
+
+static void bench_fair_dice( int sides, int n, int reps ) {
+  char label[64];
+  ProbabilityList *pl;
+  double start = now();
+  int i;
+  for ( i = 0; i < reps; i++ ) {
+    pl_fair_dice( n, sides, &pl );
+    destroy_probability_list( pl );
+  }
+  snprintf( label, sizeof(label), "fair_dice d%d x %d", sides, n );
+  report( label, reps, start );
+}
+
+static void bench_fair_dice_sweep( int sides, int n_max, int reps ) {
+  char label[64];
+  ProbabilityList *die, *pl;
+  double start = now();
+  int i, n;
+  for ( i = 0; i < reps; i++ ) {
+    pl_fair_dice( 1, sides, &die );
+    for ( n = 1; n <= n_max; n++ ) {
+      pl_repeat_sum( die, n, &pl );
+      destroy_probability_list( pl );
+    }
+    destroy_probability_list( die );
+  }
+  snprintf( label, sizeof(label), "repeat_sum d%d x 1..%d", sides, n_max );
+  report( label, reps, start );
+}
+
+static void bench_queries( int sides, int n, int reps ) {
+  char label[64];
+  ProbabilityList *die = fair_die( sides );
+  ProbabilityList *pl;
+  double start, t = 0.0;
+  int i, lo, hi;
+  pl_repeat_sum( die, n, &pl );
+  lo = pl_min( pl );
+  hi = pl_max( pl );
+  start = now();
+  for ( i = 0; i < reps; i++ ) {
+    t += pl_p_ge( pl, lo + i % ( 1 + hi - lo ) );
+  }
+  snprintf( label, sizeof(label), "p_ge on d%d x %d", sides, n );
+  report( label, reps, start );
+  if ( t < 0.0 ) printf( "%f\n", t );
+  destroy_probability_list( pl );
+  destroy_probability_list( die );
+}
+
+int main() {
+  bench_repeat_sum( 6, 30, 2000, 0 );
+  bench_repeat_sum( 6, 30, 2000, 1 );
+  bench_repeat_sum( 100, 100, 20, 0 );
+  bench_repeat_sum( 100, 100, 20, 1 );
+  bench_fair_dice( 100, 100, 20 );
+  bench_repeat_sum( 1000, 100, 2, 0 );
+  bench_fair_dice( 1000, 100, 2 );
+  bench_fair_dice_sweep( 20, 100, 5 );
+  bench_repeat_n_sum_k( 6, 4, 3, 20000 );
+  bench_repeat_n_sum_k( 20, 20, 10, 20 );
+  bench_multiplied( 10, 6, 100, 20000 );
+  bench_multiplied( 100, 20, 10, 20000 );
+  bench_queries( 10, 100, 10000000 );
+  return 0;
+}
@@ -0,0 +1,676 @@
+// ext/games_dice/core/mapped_probability_list.c
+
+#define _XOPEN_SOURCE 700
+#define _FILE_OFFSET_BITS 64
+
+#include "mapped_probability_list.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  General utils
+//
+
+#define MPL_HEADER_BYTES 32
+
+typedef struct _mh {
+    char magic[8];
+    int64_t offset;
+    int64_t stride;
+    int64_t slots;
+  } MappedHeader;
+
+static const char mpl_magic[8] = { 'G', 'D', 'P', 'R', 'O', 'B', '1', 0 };
+
+static inline void neumaier_add( double *t, double *c, double x ) {
+  double u = *t + x;
+  if ( fabs( *t ) >= fabs( x ) ) {
+    *c += ( *t - u ) + x;
+  } else {
+    *c += ( x - u ) + *t;
+  }
+  *t = u;
+}
+
+static long long gcd_ll( long long a, long long b ) {
+  long long t;
+  if ( a < 0 ) a = -a;
+  if ( b < 0 ) b = -b;
+  while ( b ) {
+    t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+// Both assume b > 0
+static inline long long floor_div( long long a, long long b ) {
+  return a >= 0 ? a / b : -1 - ( -1 - a ) / b;
+}
+
+static inline long long ceil_div( long long a, long long b ) {
+  return -floor_div( -a, b );
+}
+
+// Number of doubles in each of n windows that fit the budget
+static long long window_slots( long budget, int n ) {
+  if ( budget < MPL_MIN_BUDGET ) budget = MPL_MIN_BUDGET;
+  return budget / n / (long) sizeof(double);
+}
+
+static MappedProbabilityList *create_mapped_probability_list( void ) {
+  MappedProbabilityList *mpl = malloc( sizeof(MappedProbabilityList) );
+  if ( mpl == NULL ) return NULL;
+  mpl->offset = 0;
+  mpl->stride = 1;
+  mpl->slots = 0;
+  mpl->fd = -1;
+  mpl->path = NULL;
+  mpl->tmp_path = NULL;
+  return mpl;
+}
+
+// An incomplete result is removed, leaving any earlier file at path as it was
+void destroy_mapped_probability_list( MappedProbabilityList *mpl ) {
+  if ( mpl == NULL ) return;
+  if ( mpl->fd >= 0 ) close( mpl->fd );
+  if ( mpl->tmp_path ) unlink( mpl->tmp_path );
+  free( mpl->tmp_path );
+  free( mpl->path );
+  free( mpl );
+  return;
+}
+
+static int save_path( MappedProbabilityList *mpl, const char *path ) {
+  mpl->path = malloc( strlen( path ) + 1 );
+  if ( mpl->path == NULL ) return GD_ERR_NO_MEMORY;
+  strcpy( mpl->path, path );
+  return GD_OK;
+}
+
+// Temporary files are unlinked as soon as they are open, so nothing is left behind on exit
+static int open_temporary( void ) {
+  const char *dir = getenv( "TMPDIR" );
+  char *name;
+  int fd;
+  if ( dir == NULL || *dir == 0 ) dir = "/tmp";
+  name = malloc( strlen( dir ) + 32 );
+  if ( name == NULL ) return -1;
+  sprintf( name, "%s/games_dice_XXXXXX", dir );
+  fd = mkstemp( name );
+  if ( fd >= 0 ) unlink( name );
+  free( name );
+  return fd;
+}
+
+// The process umask can only be read by setting it, so it is read once and kept
+static mode_t process_umask( void ) {
+  static int have_mask = 0;
+  static mode_t mask;
+  if ( ! have_mask ) {
+    mask = umask( 022 );
+    umask( mask );
+    have_mask = 1;
+  }
+  return mask;
+}
+
+// Opens a new file in the same directory as mpl->path, so that mpl_complete can rename it
+static int open_beside( MappedProbabilityList *mpl ) {
+  struct stat st;
+  mode_t mode;
+  int fd;
+  mpl->tmp_path = malloc( strlen( mpl->path ) + 8 );
+  if ( mpl->tmp_path == NULL ) return -1;
+  sprintf( mpl->tmp_path, "%s.XXXXXX", mpl->path );
+  fd = mkstemp( mpl->tmp_path );
+  if ( fd < 0 ) {
+    free( mpl->tmp_path );
+    mpl->tmp_path = NULL;
+    return -1;
+  }
+  // mkstemp makes the file private. A file that is replaced keeps its permissions, and a new one
+  // gets the same permissions as one created by open() with mode 0666
+  if ( stat( mpl->path, &st ) == 0 ) {
+    mode = st.st_mode & 07777;
+  } else {
+    mode = 0666 & ~process_umask();
+  }
+  fchmod( fd, mode );
+  return fd;
+}
+
+// New distribution with all probabilities zero. The file is sparse until written to, and has no
+// header until mpl_complete, so mpl_open rejects it if it is left incomplete.
+static int mpl_create( const char *path, long long offset, long long stride, long long slots,
+    MappedProbabilityList **result ) {
+  MappedProbabilityList *mpl;
+  int err;
+
+  if ( slots < 1 ) return GD_ERR_BAD_SLOTS;
+  if ( slots > MPL_MAX_SLOTS ) return GD_ERR_TOO_MANY_SLOTS;
+  mpl = create_mapped_probability_list();
+  if ( mpl == NULL ) return GD_ERR_NO_MEMORY;
+  if ( path ) {
+    err = save_path( mpl, path );
+    if ( err ) {
+      destroy_mapped_probability_list( mpl );
+      return err;
+    }
+    mpl->fd = open_beside( mpl );
+  } else {
+    mpl->fd = open_temporary();
+  }
+  mpl->offset = offset;
+  mpl->stride = stride;
+  mpl->slots = slots;
+
+  if ( mpl->fd < 0 || ftruncate( mpl->fd, MPL_HEADER_BYTES + slots * (off_t) sizeof(double) ) != 0 ) {
+    destroy_mapped_probability_list( mpl );
+    return GD_ERR_IO;
+  }
+  *result = mpl;
+  return GD_OK;
+}
+
+// Writes the header of a finished distribution, and moves it into place if it has a path
+static int mpl_complete( MappedProbabilityList *mpl, MappedProbabilityList **result ) {
+  MappedHeader h;
+  memset( &h, 0, sizeof(h) );
+  memcpy( h.magic, mpl_magic, sizeof(mpl_magic) );
+  h.offset = mpl->offset;
+  h.stride = mpl->stride;
+  h.slots = mpl->slots;
+  if ( pwrite( mpl->fd, &h, sizeof(h), 0 ) != (ssize_t) sizeof(h) ||
+      ( mpl->tmp_path && rename( mpl->tmp_path, mpl->path ) != 0 ) ) {
+    destroy_mapped_probability_list( mpl );
+    return GD_ERR_IO;
+  }
+  free( mpl->tmp_path );
+  mpl->tmp_path = NULL;
+  *result = mpl;
+  return GD_OK;
+}
+
+int mpl_open( const char *path, MappedProbabilityList **result ) {
+  MappedHeader h;
+  struct stat st;
+  MappedProbabilityList *mpl = create_mapped_probability_list();
+  int err;
+
+  if ( mpl == NULL ) return GD_ERR_NO_MEMORY;
+  err = save_path( mpl, path );
+  if ( err ) {
+    destroy_mapped_probability_list( mpl );
+    return err;
+  }
+  mpl->fd = open( path, O_RDONLY );
+  if ( mpl->fd < 0 || fstat( mpl->fd, &st ) != 0 ) {
+    destroy_mapped_probability_list( mpl );
+    return GD_ERR_IO;
+  }
+  if ( pread( mpl->fd, &h, sizeof(h), 0 ) != (ssize_t) sizeof(h) ||
+      memcmp( h.magic, mpl_magic, sizeof(mpl_magic) ) != 0 ||
+      h.slots < 1 || h.slots > MPL_MAX_SLOTS || h.stride < 1 ||
+      st.st_size < MPL_HEADER_BYTES + h.slots * (off_t) sizeof(double) ) {
+    destroy_mapped_probability_list( mpl );
+    return GD_ERR_BAD_FILE;
+  }
+  mpl->offset = h.offset;
+  mpl->stride = h.stride;
+  mpl->slots = h.slots;
+  *result = mpl;
+  return GD_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Windows onto the probabilities in a file. Each window is mapped only while in use, so the
+//  pages held at any one time are limited by the window sizes.
+//
+
+typedef struct _mw {
+    void *base;
+    size_t length;
+    double *data;
+  } MapWindow;
+
+// Maps probs[start] .. probs[start + count - 1] of the file to w->data
+static int map_window( MappedProbabilityList *mpl, long long start, long long count, int writable,
+    MapWindow *w ) {
+  off_t pos = MPL_HEADER_BYTES + start * (off_t) sizeof(double);
+  off_t aligned = pos - pos % sysconf( _SC_PAGESIZE );
+  w->length = ( pos - aligned ) + count * sizeof(double);
+  w->base = mmap( NULL, w->length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+      mpl->fd, aligned );
+  if ( w->base == MAP_FAILED ) {
+    w->base = NULL;
+    return GD_ERR_IO;
+  }
+  w->data = (double *) ( (char *) w->base + ( pos - aligned ) );
+  return GD_OK;
+}
+
+static void unmap_window( MapWindow *w ) {
+  if ( w->base ) munmap( w->base, w->length );
+  w->base = NULL;
+  return;
+}
+
+// Sum of probs[lo] .. probs[hi], optionally weighted by result. Upper tails are summed from the
+// top down, as for ProbabilityList survival, to keep small totals accurate.
+static int mpl_sum( MappedProbabilityList *mpl, long long lo, long long hi, long budget,
+    int from_top, int weighted, double *result ) {
+  MapWindow w;
+  long long window = window_slots( budget, 1 );
+  long long b0, b1, i;
+  double t = 0.0, c = 0.0, x;
+  int err;
+
+  for ( b0 = lo; b0 <= hi; b0 += window ) {
+    b1 = b0 + window - 1 < hi ? b0 + window - 1 : hi;
+    if ( from_top ) {
+      // Same blocks, visited in reverse
+      long long r0 = hi - ( b1 - lo );
+      long long r1 = hi - ( b0 - lo );
+      err = map_window( mpl, r0, 1 + r1 - r0, 0, &w );
+      if ( err ) return err;
+      for ( i = r1; i >= r0; i-- ) {
+        x = w.data[ i - r0 ];
+        if ( weighted ) x *= (double) ( mpl->offset + i * mpl->stride );
+        neumaier_add( &t, &c, x );
+      }
+    } else {
+      err = map_window( mpl, b0, 1 + b1 - b0, 0, &w );
+      if ( err ) return err;
+      for ( i = b0; i <= b1; i++ ) {
+        x = w.data[ i - b0 ];
+        if ( weighted ) x *= (double) ( mpl->offset + i * mpl->stride );
+        neumaier_add( &t, &c, x );
+      }
+    }
+    unmap_window( &w );
+  }
+  *result = t + c;
+  return GD_OK;
+}
+
+static int mpl_copy( MappedProbabilityList *mpl, const char *path, long budget,
+    MappedProbabilityList **result ) {
+  MapWindow w_from, w_to;
+  MappedProbabilityList *new_mpl;
+  long long window = window_slots( budget, 2 );
+  long long b0, n;
+  int err = mpl_create( path, mpl->offset, mpl->stride, mpl->slots, &new_mpl );
+  if ( err ) return err;
+
+  for ( b0 = 0; b0 < mpl->slots; b0 += window ) {
+    n = mpl->slots - b0 < window ? mpl->slots - b0 : window;
+    err = map_window( mpl, b0, n, 0, &w_from );
+    if ( err ) break;
+    err = map_window( new_mpl, b0, n, 1, &w_to );
+    if ( err ) {
+      unmap_window( &w_from );
+      break;
+    }
+    memcpy( w_to.data, w_from.data, n * sizeof(double) );
+    unmap_window( &w_to );
+    unmap_window( &w_from );
+  }
+  if ( err ) {
+    destroy_mapped_probability_list( new_mpl );
+    return err;
+  }
+  return mpl_complete( new_mpl, result );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Conversion to and from ProbabilityList
+//
+
+int mpl_from_probability_list( ProbabilityList *pl, const char *path, MappedProbabilityList **result ) {
+  MapWindow w;
+  MappedProbabilityList *mpl;
+  int i;
+  int err = mpl_create( path, pl->offset, pl->stride, pl->slots, &mpl );
+  if ( err ) return err;
+  err = map_window( mpl, 0, pl->slots, 1, &w );
+  if ( err ) {
+    destroy_mapped_probability_list( mpl );
+    return err;
+  }
+  for ( i = 0; i < pl->slots; i++ ) {
+    w.data[i] = pl_p_eql( pl, pl->offset + i * pl->stride );
+  }
+  unmap_window( &w );
+  return mpl_complete( mpl, result );
+}
+
+int mpl_to_probability_list( MappedProbabilityList *mpl, ProbabilityList **result ) {
+  MapWindow w;
+  ProbabilityList *pl;
+  int err;
+
+  if ( mpl->slots > PL_MAX_SLOTS || mpl->stride > 0x7fffffff ||
+      mpl_min( mpl ) < -0x7fffffffLL || mpl_max( mpl ) > 0x7fffffffLL ) {
+    return GD_ERR_TOO_MANY_SLOTS;
+  }
+  err = new_basic_pl( (int) mpl->slots, 0.0, (int) mpl->offset, &pl );
+  if ( err ) return err;
+  pl->stride = (int) mpl->stride;
+  err = map_window( mpl, 0, mpl->slots, 0, &w );
+  if ( err ) {
+    destroy_probability_list( pl );
+    return err;
+  }
+  memcpy( pl->probs, w.data, mpl->slots * sizeof(double) );
+  unmap_window( &w );
+  calc_cumulative( pl );
+  *result = pl;
+  return GD_OK;
+}
+
+int mpl_for_fair_die( long long sides, const char *path, long budget, MappedProbabilityList **result ) {
+  MapWindow w;
+  MappedProbabilityList *mpl;
+  long long window = window_slots( budget, 1 );
+  long long b0, n, i;
+  int err = mpl_create( path, 1, 1, sides, &mpl );
+  if ( err ) return err;
+
+  for ( b0 = 0; b0 < sides; b0 += window ) {
+    n = sides - b0 < window ? sides - b0 : window;
+    err = map_window( mpl, b0, n, 1, &w );
+    if ( err ) {
+      destroy_mapped_probability_list( mpl );
+      return err;
+    }
+    for ( i = 0; i < n; i++ ) {
+      w.data[i] = 1.0 / sides;
+    }
+    unmap_window( &w );
+  }
+  return mpl_complete( mpl, result );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Queries. Nothing is cached between calls, so cumulative queries read the file each time.
+//
+
+long long mpl_min( MappedProbabilityList *mpl ) {
+  return mpl->offset;
+}
+
+long long mpl_max( MappedProbabilityList *mpl ) {
+  return mpl->offset + ( mpl->slots - 1 ) * mpl->stride;
+}
+
+int mpl_p_eql( MappedProbabilityList *mpl, long long target, double *result ) {
+  MapWindow w;
+  long long d = target - mpl->offset;
+  int err;
+  if ( d < 0 || d % mpl->stride || d / mpl->stride >= mpl->slots ) {
+    *result = 0.0;
+    return GD_OK;
+  }
+  err = map_window( mpl, d / mpl->stride, 1, 0, &w );
+  if ( err ) return err;
+  *result = w.data[0];
+  unmap_window( &w );
+  return GD_OK;
+}
+
+int mpl_p_le( MappedProbabilityList *mpl, long long target, long budget, double *result ) {
+  long long idx = floor_div( target - mpl->offset, mpl->stride );
+  if ( idx < 0 ) {
+    *result = 0.0;
+    return GD_OK;
+  }
+  if ( idx >= mpl->slots - 1 ) {
+    *result = 1.0;
+    return GD_OK;
+  }
+  return mpl_sum( mpl, 0, idx, budget, 0, 0, result );
+}
+
+int mpl_p_gt( MappedProbabilityList *mpl, long long target, long budget, double *result ) {
+  long long idx = floor_div( target - mpl->offset, mpl->stride );
+  if ( idx < 0 ) {
+    *result = 1.0;
+    return GD_OK;
+  }
+  if ( idx >= mpl->slots - 1 ) {
+    *result = 0.0;
+    return GD_OK;
+  }
+  return mpl_sum( mpl, idx + 1, mpl->slots - 1, budget, 1, 0, result );
+}
+
+int mpl_expected( MappedProbabilityList *mpl, long budget, double *result ) {
+  return mpl_sum( mpl, 0, mpl->slots - 1, budget, 0, 1, result );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Block-streaming convolution. The result is built one output block at a time; for each one,
+//  only the blocks of a and b that can contribute to it are mapped. With all three windows the
+//  same size, memory use is fixed by the budget, and each input block is read about
+//  (input slots / window) times.
+//
+
+// c[k] += a[i] * b[j] for every i * step_a + j * step_b == k. Cancel is checked before each
+// block of b, which takes well under a second at any budget.
+static int convolve_blocks( MappedProbabilityList *a, MappedProbabilityList *b,
+    MappedProbabilityList *c, long long step_a, long long step_b, long long window,
+    volatile int *cancel ) {
+  MapWindow wa, wb, wc;
+  long long c0, c1, a0, a1, b0, b1, i_lo, i_hi, j_lo, j_hi, i, j, jl, jh, base;
+  double pa;
+  int err = GD_OK;
+
+  for ( c0 = 0; c0 < c->slots && ! err; c0 += window ) {
+    c1 = c0 + window < c->slots ? c0 + window : c->slots;
+    err = map_window( c, c0, c1 - c0, 1, &wc );
+    if ( err ) break;
+
+    // Indices of a that reach [c0, c1) with some index of b
+    i_lo = ceil_div( c0 - ( b->slots - 1 ) * step_b, step_a );
+    if ( i_lo < 0 ) i_lo = 0;
+    i_hi = floor_div( c1 - 1, step_a );
+    if ( i_hi > a->slots - 1 ) i_hi = a->slots - 1;
+
+    for ( a0 = i_lo; a0 <= i_hi && ! err; a0 += window ) {
+      a1 = a0 + window - 1 < i_hi ? a0 + window - 1 : i_hi;
+      err = map_window( a, a0, 1 + a1 - a0, 0, &wa );
+      if ( err ) break;
+
+      j_lo = ceil_div( c0 - a1 * step_a, step_b );
+      if ( j_lo < 0 ) j_lo = 0;
+      j_hi = floor_div( c1 - 1 - a0 * step_a, step_b );
+      if ( j_hi > b->slots - 1 ) j_hi = b->slots - 1;
+
+      for ( b0 = j_lo; b0 <= j_hi; b0 += window ) {
+        b1 = b0 + window - 1 < j_hi ? b0 + window - 1 : j_hi;
+        if ( cancel && *cancel ) {
+          err = GD_ERR_INTERRUPTED;
+          break;
+        }
+        err = map_window( b, b0, 1 + b1 - b0, 0, &wb );
+        if ( err ) break;
+
+        for ( i = a0; i <= a1; i++ ) {
+          pa = wa.data[ i - a0 ];
+          if ( pa == 0.0 ) continue;
+          base = i * step_a;
+          jl = ceil_div( c0 - base, step_b );
+          if ( jl < b0 ) jl = b0;
+          jh = floor_div( c1 - 1 - base, step_b );
+          if ( jh > b1 ) jh = b1;
+          if ( step_b == 1 ) {
+            double *pc = wc.data + ( base + jl - c0 );
+            double *pb = wb.data + ( jl - b0 );
+            for ( j = 0; j <= jh - jl; j++ ) {
+              pc[j] += pa * pb[j];
+            }
+          } else {
+            for ( j = jl; j <= jh; j++ ) {
+              wc.data[ base + j * step_b - c0 ] += pa * wb.data[ j - b0 ];
+            }
+          }
+        }
+        unmap_window( &wb );
+      }
+      unmap_window( &wa );
+    }
+    unmap_window( &wc );
+  }
+  return err;
+}
+
+int mpl_add_distributions( MappedProbabilityList *mpl_a, MappedProbabilityList *mpl_b,
+    const char *path, long budget, volatile int *cancel, MappedProbabilityList **result ) {
+  MappedProbabilityList *mpl;
+  long long g = gcd_ll( mpl_a->slots > 1 ? mpl_a->stride : 0, mpl_b->slots > 1 ? mpl_b->stride : 0 );
+  long long step_a, step_b, slots;
+  int err;
+
+  if ( g == 0 ) g = 1;
+  // A single slot can use any step, 1 avoids dividing by zero
+  step_a = mpl_a->slots > 1 ? mpl_a->stride / g : 1;
+  step_b = mpl_b->slots > 1 ? mpl_b->stride / g : 1;
+  if ( ( mpl_a->slots - 1 ) * step_a > MPL_MAX_SLOTS || ( mpl_b->slots - 1 ) * step_b > MPL_MAX_SLOTS ) {
+    return GD_ERR_TOO_MANY_SLOTS;
+  }
+  slots = 1 + ( mpl_a->slots - 1 ) * step_a + ( mpl_b->slots - 1 ) * step_b;
+
+  err = mpl_create( path, mpl_a->offset + mpl_b->offset, g, slots, &mpl );
+  if ( err ) return err;
+  err = convolve_blocks( mpl_a, mpl_b, mpl, step_a, step_b, window_slots( budget, 3 ), cancel );
+  if ( err ) {
+    destroy_mapped_probability_list( mpl );
+    return err;
+  }
+  return mpl_complete( mpl, result );
+}
+
+// Same sequence of squarings as pl_repeat_sum. Only the final sum is written to path.
+int mpl_repeat_sum( MappedProbabilityList *mpl, long long n, const char *path, long budget,
+    volatile int *cancel, MappedProbabilityList **result ) {
+  MappedProbabilityList *power = mpl;
+  MappedProbabilityList *sum = NULL;
+  MappedProbabilityList *next = NULL;
+  long long bit = 1;
+  int own_power = 0;
+  int last;
+  int err = GD_OK;
+
+  if ( n < 1 ) {
+    return GD_ERR_N_TOO_SMALL;
+  }
+  if ( mpl->slots - 1 > ( MPL_MAX_SLOTS - 1 ) / n ) {
+    return GD_ERR_TOO_MANY_SLOTS;
+  }
+
+  while ( 1 ) {
+    last = ( bit << 1 ) > n;
+    if ( bit & n ) {
+      if ( sum ) {
+        err = mpl_add_distributions( sum, power, last ? path : NULL, budget, cancel, &next );
+      } else {
+        err = mpl_copy( power, last ? path : NULL, budget, &next );
+      }
+      if ( err ) break;
+      destroy_mapped_probability_list( sum );
+      sum = next;
+    }
+    if ( last ) break;
+    bit = bit << 1;
+    err = mpl_add_distributions( power, power, NULL, budget, cancel, &next );
+    if ( err ) break;
+    if ( own_power ) destroy_mapped_probability_list( power );
+    power = next;
+    own_power = 1;
+  }
+  if ( own_power ) destroy_mapped_probability_list( power );
+
+  if ( err ) {
+    destroy_mapped_probability_list( sum );
+    return err;
+  }
+  *result = sum;
+  return GD_OK;
+}
+
+#else
+
+// Memory-mapped files are only implemented for POSIX systems
+
+void destroy_mapped_probability_list( MappedProbabilityList *mpl ) {
+  free( mpl );
+}
+
+int mpl_open( const char *path, MappedProbabilityList **result ) {
+  return GD_ERR_NOT_SUPPORTED;
+}
+
+int mpl_from_probability_list( ProbabilityList *pl, const char *path, MappedProbabilityList **result ) {
+  return GD_ERR_NOT_SUPPORTED;
+}
+
+int mpl_to_probability_list( MappedProbabilityList *mpl, ProbabilityList **result ) {
+  return GD_ERR_NOT_SUPPORTED;
+}
+
+int mpl_for_fair_die( long long sides, const char *path, long budget, MappedProbabilityList **result ) {
+  return GD_ERR_NOT_SUPPORTED;
+}
+
+long long mpl_min( MappedProbabilityList *mpl ) {
+  return mpl->offset;
+}
+
+long long mpl_max( MappedProbabilityList *mpl ) {
+  return mpl->offset + ( mpl->slots - 1 ) * mpl->stride;
+}
+
+int mpl_p_eql( MappedProbabilityList *mpl, long long target, double *result ) {
+  return GD_ERR_NOT_SUPPORTED;
+}
+
+int mpl_p_le( MappedProbabilityList *mpl, long long target, long budget, double *result ) {
+  return GD_ERR_NOT_SUPPORTED;
+}
+
+int mpl_p_gt( MappedProbabilityList *mpl, long long target, long budget, double *result ) {
+  return GD_ERR_NOT_SUPPORTED;
+}
+
+int mpl_expected( MappedProbabilityList *mpl, long budget, double *result ) {
+  return GD_ERR_NOT_SUPPORTED;
+}
+
+int mpl_add_distributions( MappedProbabilityList *mpl_a, MappedProbabilityList *mpl_b,
+    const char *path, long budget, volatile int *cancel, MappedProbabilityList **result ) {
+  return GD_ERR_NOT_SUPPORTED;
+}
+
+int mpl_repeat_sum( MappedProbabilityList *mpl, long long n, const char *path, long budget,
+    volatile int *cancel, MappedProbabilityList **result ) {
+  return GD_ERR_NOT_SUPPORTED;
+}
+
+#endif
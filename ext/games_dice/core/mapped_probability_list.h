@@ -0,0 +1,68 @@
+// ext/games_dice/core/mapped_probability_list.h
+
+// Distributions held in files rather than memory, for results too large for a ProbabilityList.
+// Convolution works through the files in blocks, so memory use is set by a budget rather than
+// by the size of the result. Temporary files are created in $TMPDIR (or /tmp) and unlinked
+// straight away, so they are removed when closed. A result with a path is written to a new file
+// beside it, which replaces path only once complete, so path may also be one of the inputs.
+// Long calculations take a cancel flag, and stop with GD_ERR_INTERRUPTED once it is non-zero.
+//
+// File format, in native byte order:
+//   char    magic[8]   "GDPROB1" plus a zero byte
+//   int64_t offset     result at index 0
+//   int64_t stride     gap between results
+//   int64_t slots      number of results
+//   double  probs[slots]
+
+#ifndef GD_MAPPED_PROBABILITY_LIST_H
+#define GD_MAPPED_PROBABILITY_LIST_H
+
+#include "probability_list.h"
+
+// Largest number of results in a mapped distribution, 512GB of file
+#define MPL_MAX_SLOTS ( 1LL << 36 )
+
+// Default and smallest memory budgets, in bytes
+#define MPL_DEFAULT_BUDGET ( 64L << 20 )
+#define MPL_MIN_BUDGET ( 16L << 10 )
+
+typedef struct _mpd {
+    long long offset;
+    long long stride;
+    long long slots;
+    int fd;
+    // Location of the file, or NULL for an unlinked temporary file
+    char *path;
+    // File being written in place of path, until the result is complete
+    char *tmp_path;
+  } MappedProbabilityList;
+
+void destroy_mapped_probability_list( MappedProbabilityList *mpl );
+
+int mpl_open( const char *path, MappedProbabilityList **result );
+
+int mpl_from_probability_list( ProbabilityList *pl, const char *path, MappedProbabilityList **result );
+
+int mpl_to_probability_list( MappedProbabilityList *mpl, ProbabilityList **result );
+
+int mpl_for_fair_die( long long sides, const char *path, long budget, MappedProbabilityList **result );
+
+long long mpl_min( MappedProbabilityList *mpl );
+
+long long mpl_max( MappedProbabilityList *mpl );
+
+int mpl_p_eql( MappedProbabilityList *mpl, long long target, double *result );
+
+int mpl_p_le( MappedProbabilityList *mpl, long long target, long budget, double *result );
+
+int mpl_p_gt( MappedProbabilityList *mpl, long long target, long budget, double *result );
+
+int mpl_expected( MappedProbabilityList *mpl, long budget, double *result );
+
+int mpl_add_distributions( MappedProbabilityList *mpl_a, MappedProbabilityList *mpl_b,
+    const char *path, long budget, volatile int *cancel, MappedProbabilityList **result );
+
+int mpl_repeat_sum( MappedProbabilityList *mpl, long long n, const char *path, long budget,
+    volatile int *cancel, MappedProbabilityList **result );
+
+#endif
@@ -0,0 +1,1368 @@
+// ext/games_dice/core/probability_list.c
+
+#include "probability_list.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Error codes
+//
+
+const char *gd_error_message( int err ) {
+  switch ( err ) {
+    case GD_OK: return "No error";
+    case GD_ERR_NO_MEMORY: return "Could not allocate memory for Probabilities";
+    case GD_ERR_BAD_SLOTS: return "Bad number of probability slots";
+    case GD_ERR_BAD_PROBABILITY: return "Bad single probability value";
+    case GD_ERR_TOO_MANY_SLOTS: return "Too many probability slots";
+    case GD_ERR_DIVIDE_BY_ZERO: return "Cannot calculate given probabilities, divide by zero";
+    case GD_ERR_N_TOO_SMALL: return "Cannot calculate repeat_sum when n < 1";
+    case GD_ERR_K_TOO_SMALL: return "Cannot calculate repeat_n_sum_k when k < 1";
+    case GD_ERR_TOO_MANY_DICE: return "Too many dice to calculate combinations";
+    case GD_ERR_BAD_STORAGE: return "Unknown storage mode";
+    case GD_ERR_IO: return "Could not read or write distribution file";
+    case GD_ERR_BAD_FILE: return "Not a games_dice distribution file";
+    case GD_ERR_NOT_SUPPORTED: return "Not supported on this platform";
+    case GD_ERR_INTERRUPTED: return "Calculation was interrupted";
+  }
+  return "Unknown error";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  General utils
+//
+
+static inline int max( int *a, int n ) {
+  int m = -1000000000;
+  int i;
+  for ( i=0; i < n; i++ ) {
+    m = a[i] > m ? a[i] : m;
+  }
+  return m;
+}
+
+static inline int min( int *a, int n ) {
+  int m = 1000000000;
+  int i;
+  for ( i=0; i < n; i++ ) {
+    m = a[i] < m ? a[i] : m;
+  }
+  return m;
+}
+
+int gd_gcd( int a, int b ) {
+  int t;
+  if ( a < 0 ) a = -a;
+  if ( b < 0 ) b = -b;
+  while ( b ) {
+    t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+// Running totals use Neumaier summation, so that long arrays of small values (e.g. the tails of
+// large dice pools) do not accumulate rounding errors
+static inline void neumaier_add( double *t, double *c, double x ) {
+  double u = *t + x;
+  if ( fabs( *t ) >= fabs( x ) ) {
+    *c += ( *t - u ) + x;
+  } else {
+    *c += ( x - u ) + *t;
+  }
+  *t = u;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Quick factorials, that fit into doubles. . . the size of this structure sets the
+//  maximum possible n in repeat_n_sum_k calculations
+//
+
+// There is no point calculating these, a cache of them is just fine.
+static const double nfact[171] = {
+  1.0, 1.0, 2.0, 6.0,
+  24.0, 120.0, 720.0, 5040.0,
+  40320.0, 362880.0, 3628800.0, 39916800.0,
+  479001600.0, 6227020800.0, 87178291200.0, 1307674368000.0,
+  20922789888000.0, 355687428096000.0, 6402373705728000.0, 121645100408832000.0,
+  2432902008176640000.0, 51090942171709440000.0, 1124000727777607700000.0, 25852016738884980000000.0,
+  620448401733239400000000.0, 15511210043330986000000000.0, 403291461126605650000000000.0, 10888869450418352000000000000.0,
+  304888344611713870000000000000.0, 8841761993739702000000000000000.0, 2.6525285981219107e+32, 8.222838654177922e+33,
+  2.631308369336935e+35, 8.683317618811886e+36, 2.9523279903960416e+38, 1.0333147966386145e+40,
+  3.7199332678990125e+41, 1.3763753091226346e+43, 5.230226174666011e+44, 2.0397882081197444e+46,
+  8.159152832478977e+47, 3.345252661316381e+49, 1.40500611775288e+51, 6.041526306337383e+52,
+  2.658271574788449e+54, 1.1962222086548019e+56, 5.502622159812089e+57, 2.5862324151116818e+59,
+  1.2413915592536073e+61, 6.082818640342675e+62, 3.0414093201713376e+64, 1.5511187532873822e+66,
+  8.065817517094388e+67, 4.2748832840600255e+69, 2.308436973392414e+71, 1.2696403353658276e+73,
+  7.109985878048635e+74, 4.0526919504877214e+76, 2.3505613312828785e+78, 1.3868311854568984e+80,
+  8.32098711274139e+81, 5.075802138772248e+83, 3.146997326038794e+85, 1.98260831540444e+87,
+  1.2688693218588417e+89, 8.247650592082472e+90, 5.443449390774431e+92, 3.647111091818868e+94,
+  2.4800355424368305e+96, 1.711224524281413e+98, 1.1978571669969892e+100, 8.504785885678623e+101,
+  6.1234458376886085e+103, 4.4701154615126844e+105, 3.307885441519386e+107, 2.48091408113954e+109,
+  1.8854947016660504e+111, 1.4518309202828587e+113, 1.1324281178206297e+115, 8.946182130782976e+116,
+  7.156945704626381e+118, 5.797126020747368e+120, 4.753643337012842e+122, 3.945523969720659e+124,
+  3.314240134565353e+126, 2.81710411438055e+128, 2.4227095383672734e+130, 2.107757298379528e+132,
+  1.8548264225739844e+134, 1.650795516090846e+136, 1.4857159644817615e+138, 1.352001527678403e+140,
+  1.2438414054641308e+142, 1.1567725070816416e+144, 1.087366156656743e+146, 1.032997848823906e+148,
+  9.916779348709496e+149, 9.619275968248212e+151, 9.426890448883248e+153, 9.332621544394415e+155,
+  9.332621544394415e+157, 9.42594775983836e+159, 9.614466715035127e+161, 9.90290071648618e+163,
+  1.0299016745145628e+166, 1.081396758240291e+168, 1.1462805637347084e+170, 1.226520203196138e+172,
+  1.324641819451829e+174, 1.4438595832024937e+176, 1.588245541522743e+178, 1.7629525510902446e+180,
+  1.974506857221074e+182, 2.2311927486598138e+184, 2.5435597334721877e+186, 2.925093693493016e+188,
+  3.393108684451898e+190, 3.969937160808721e+192, 4.684525849754291e+194, 5.574585761207606e+196,
+  6.689502913449127e+198, 8.094298525273444e+200, 9.875044200833601e+202, 1.214630436702533e+205,
+  1.506141741511141e+207, 1.882677176888926e+209, 2.372173242880047e+211, 3.0126600184576594e+213,
+  3.856204823625804e+215, 4.974504222477287e+217, 6.466855489220474e+219, 8.47158069087882e+221,
+  1.1182486511960043e+224, 1.4872707060906857e+226, 1.9929427461615188e+228, 2.6904727073180504e+230,
+  3.659042881952549e+232, 5.012888748274992e+234, 6.917786472619489e+236, 9.615723196941089e+238,
+  1.3462012475717526e+241, 1.898143759076171e+243, 2.695364137888163e+245, 3.854370717180073e+247,
+  5.5502938327393044e+249, 8.047926057471992e+251, 1.1749972043909107e+254, 1.727245890454639e+256,
+  2.5563239178728654e+258, 3.80892263763057e+260, 5.713383956445855e+262, 8.62720977423324e+264,
+  1.3113358856834524e+267, 2.0063439050956823e+269, 3.0897696138473508e+271, 4.789142901463394e+273,
+  7.471062926282894e+275, 1.1729568794264145e+278, 1.853271869493735e+280, 2.9467022724950384e+282,
+  4.7147236359920616e+284, 7.590705053947219e+286, 1.2296942187394494e+289, 2.0044015765453026e+291,
+  3.287218585534296e+293, 5.423910666131589e+295, 9.003691705778438e+297, 1.503616514864999e+300,
+  2.5260757449731984e+302, 4.269068009004705e+304, 7.257415615307999e+306 };
+
+// Callers ensure that the sum of args is no more than PL_MAX_KEEP_DICE
+static double num_arrangements( int *args, int nargs ) {
+  int sum = 0;
+  double div_by = 1.0;
+  int i;
+  for ( i = 0; i < nargs; i++ ) {
+    sum += args[i];
+    div_by *= nfact[ args[i] ];
+  }
+  return nfact[ sum ] / div_by;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Probability List basics - create, delete, copy
+//
+
+ProbabilityList *create_probability_list() {
+  ProbabilityList *pl;
+  pl = malloc (sizeof(ProbabilityList));
+  if ( pl == NULL ) {
+    return NULL;
+  }
+  pl->probs = NULL;
+  pl->cumulative = NULL;
+  pl->survival = NULL;
+  pl->slots = 0;
+  pl->offset = 0;
+  pl->stride = 1;
+  pl->powers = NULL;
+  pl->power_cache_slots = 0;
+  pl->dense = NULL;
+  pl->given = NULL;
+  pl->given_cache_slots = 0;
+  pl->storage = PL_STORAGE_DOUBLE;
+  pl->packed = NULL;
+  pl->packed_scale = 1.0;
+  pl->parent = NULL;
+  pl->view_start = 0;
+  pl->view_scale = 1.0;
+  pl->fair_dice = 0;
+  pl->fair_sides = 0;
+  pl->refs = 1;
+  pl->host_memsize = 0;
+  return pl;
+}
+
+void destroy_probability_list( ProbabilityList *pl ) {
+  if ( pl == NULL ) return;
+  if ( --pl->refs > 0 ) return;
+  destroy_probability_list( pl->parent );
+  pl_clear_power_cache( pl );
+  free( pl->packed );
+  free( pl->survival );
+  free( pl->cumulative );
+  free( pl->probs );
+  free( pl );
+  return;
+}
+
+int alloc_probs( ProbabilityList *pl, int slots ) {
+  if ( slots < 1 || slots > PL_MAX_SLOTS ) {
+    return GD_ERR_BAD_SLOTS;
+  }
+  pl_clear_power_cache( pl );
+  destroy_probability_list( pl->parent );
+  free( pl->packed );
+  free( pl->survival );
+  free( pl->cumulative );
+  free( pl->probs );
+  pl->parent = NULL;
+  pl->packed = NULL;
+  pl->storage = PL_STORAGE_DOUBLE;
+  pl->fair_dice = 0;
+  pl->survival = NULL;
+  pl->slots = slots;
+
+  pl->probs = malloc( slots * sizeof(double) );
+  pl->cumulative = malloc( slots * sizeof(double) );
+  if ( pl->probs == NULL || pl->cumulative == NULL ) {
+    free( pl->probs );
+    free( pl->cumulative );
+    pl->probs = NULL;
+    pl->cumulative = NULL;
+    pl->slots = 0;
+    return GD_ERR_NO_MEMORY;
+  }
+  return GD_OK;
+}
+
+double calc_cumulative( ProbabilityList *pl ) {
+  double *c = pl->cumulative;
+  double *pr = pl->probs;
+  int i;
+  double t = 0.0;
+  double err = 0.0;
+  for(i=0; i < pl->slots; i++) {
+    neumaier_add( &t, &err, pr[i] );
+    c[i] = t + err;
+  }
+  // Any survival array is now out of date
+  free( pl->survival );
+  pl->survival = NULL;
+  return t + err;
+}
+
+// Upper tail totals, summed from the top down so that small tails keep full relative precision.
+// Returns NULL if there is no memory for the array.
+static double *pl_survival( ProbabilityList *pl ) {
+  double *sv;
+  double *pr = pl->probs;
+  int i;
+  double t = 0.0;
+  double err = 0.0;
+  if ( pl->survival ) return pl->survival;
+
+  sv = malloc( pl->slots * sizeof(double) );
+  if ( sv == NULL ) return NULL;
+  for( i = pl->slots - 1; i >= 0; i-- ) {
+    neumaier_add( &t, &err, pr[i] );
+    sv[i] = t + err;
+  }
+  pl->survival = sv;
+  return sv;
+}
+
+// Probability at index i, for any storage mode except views
+static inline double pl_stored_prob( ProbabilityList *pl, int i ) {
+  switch ( pl->storage ) {
+    case PL_STORAGE_FLOAT32:
+      return ( (float *) pl->packed )[i];
+    case PL_STORAGE_Q16:
+      return ( (uint16_t *) pl->packed )[i] * pl->packed_scale;
+  }
+  return pl->probs[i];
+}
+
+// Probability at index i, for any storage mode
+static inline double pl_prob( ProbabilityList *pl, int i ) {
+  if ( pl->storage == PL_STORAGE_VIEW ) {
+    return pl_stored_prob( pl->parent, pl->view_start + i ) * pl->view_scale;
+  }
+  return pl_stored_prob( pl, i );
+}
+
+// Sum of probabilities from index lo to hi inclusive. Compact storage has no cumulative array,
+// so queries on it add up the values they need each time.
+static double pl_packed_sum( ProbabilityList *pl, int lo, int hi ) {
+  int i;
+  double t = 0.0;
+  double err = 0.0;
+  for ( i = lo; i <= hi; i++ ) {
+    neumaier_add( &t, &err, pl_prob( pl, i ) );
+  }
+  return t + err;
+}
+
+// Sum of probabilities from index lo to hi inclusive of a view. With a double-precision parent,
+// any range is a difference of two of its running totals, so views are queried in constant time.
+// Each range is taken from whichever of the cumulative and survival totals is smaller at its far
+// end, so rounding error is relative to the range itself, and tails keep full precision.
+static double pl_view_sum( ProbabilityList *pl, int lo, int hi ) {
+  ProbabilityList *parent = pl->parent;
+  double *cum = parent->cumulative;
+  double *sv;
+  int a = pl->view_start + lo;
+  int b = pl->view_start + hi;
+  double below = a > 0 ? cum[ a - 1 ] : 0.0;
+
+  if ( parent->storage != PL_STORAGE_DOUBLE ) {
+    return pl_packed_sum( pl, lo, hi );
+  }
+  if ( cum[b] > cum[ parent->slots - 1 ] - below && ( sv = pl_survival( parent ) ) != NULL ) {
+    return ( sv[a] - ( b + 1 < parent->slots ? sv[ b + 1 ] : 0.0 ) ) * pl->view_scale;
+  }
+  return ( cum[b] - below ) * pl->view_scale;
+}
+
+// New view of slots start to start + slots - 1 of pl, each probability multiplied by scale
+static int pl_new_view( ProbabilityList *pl, int start, int slots, double scale,
+    ProbabilityList **result ) {
+  ProbabilityList *view;
+  if ( slots < 1 || slots > PL_MAX_SLOTS ) {
+    return GD_ERR_BAD_SLOTS;
+  }
+  view = create_probability_list();
+  if ( view == NULL ) return GD_ERR_NO_MEMORY;
+  view->storage = PL_STORAGE_VIEW;
+  view->slots = slots;
+  view->offset = pl->offset + start * pl->stride;
+  view->stride = pl->stride;
+  if ( pl->storage == PL_STORAGE_VIEW ) {
+    view->parent = pl->parent;
+    view->view_start = pl->view_start + start;
+    view->view_scale = pl->view_scale * scale;
+  } else {
+    view->parent = pl;
+    view->view_start = start;
+    view->view_scale = scale;
+  }
+  view->parent->refs++;
+  *result = view;
+  return GD_OK;
+}
+
+static size_t packed_item_size( int storage ) {
+  return storage == PL_STORAGE_Q16 ? sizeof(uint16_t) : sizeof(float);
+}
+
+int alloc_probs_iv( ProbabilityList *pl, int slots, double iv ) {
+  int i, err;
+
+  if ( iv < 0.0 || iv > 1.0 ) {
+    return GD_ERR_BAD_PROBABILITY;
+  }
+  err = alloc_probs( pl, slots );
+  if ( err ) return err;
+  for(i=0; i<slots; i++) {
+    pl->probs[i] = iv;
+  }
+  calc_cumulative( pl );
+  return GD_OK;
+}
+
+int copy_probability_list( ProbabilityList *orig, ProbabilityList **result ) {
+  int err;
+  size_t bytes;
+  ProbabilityList *pl;
+  if ( orig->storage == PL_STORAGE_VIEW ) {
+    return pl_new_view( orig, 0, orig->slots, 1.0, result );
+  }
+  pl = create_probability_list();
+  if ( pl == NULL ) return GD_ERR_NO_MEMORY;
+  if ( orig->storage != PL_STORAGE_DOUBLE ) {
+    bytes = orig->slots * packed_item_size( orig->storage );
+    pl->packed = malloc( bytes );
+    if ( pl->packed == NULL ) {
+      destroy_probability_list( pl );
+      return GD_ERR_NO_MEMORY;
+    }
+    memcpy( pl->packed, orig->packed, bytes );
+    pl->storage = orig->storage;
+    pl->packed_scale = orig->packed_scale;
+    pl->slots = orig->slots;
+    pl->offset = orig->offset;
+    pl->stride = orig->stride;
+    *result = pl;
+    return GD_OK;
+  }
+  err = alloc_probs( pl, orig->slots );
+  if ( err ) {
+    destroy_probability_list( pl );
+    return err;
+  }
+  pl->offset = orig->offset;
+  pl->stride = orig->stride;
+  pl->fair_dice = orig->fair_dice;
+  pl->fair_sides = orig->fair_sides;
+  memcpy( pl->probs, orig->probs, orig->slots * sizeof(double) );
+  memcpy( pl->cumulative, orig->cumulative, orig->slots * sizeof(double) );
+  *result = pl;
+  return GD_OK;
+}
+
+int new_basic_pl( int nslots, double iv, int o, ProbabilityList **result ) {
+  int err;
+  ProbabilityList *pl = create_probability_list();
+  if ( pl == NULL ) return GD_ERR_NO_MEMORY;
+  err = alloc_probs_iv( pl, nslots, iv );
+  if ( err ) {
+    destroy_probability_list( pl );
+    return err;
+  }
+  pl->offset = o;
+  *result = pl;
+  return GD_OK;
+}
+
+// Total bytes allocated for a distribution, including lazily-built arrays and cached powers. The
+// arrays shared by a view are counted only for the distribution that owns them.
+size_t pl_memsize( ProbabilityList *pl ) {
+  size_t size = sizeof(ProbabilityList);
+  int i;
+  if ( pl->probs ) size += pl->slots * sizeof(double);
+  if ( pl->cumulative ) size += pl->slots * sizeof(double);
+  if ( pl->survival ) size += pl->slots * sizeof(double);
+  if ( pl->packed ) size += pl->slots * packed_item_size( pl->storage );
+  if ( pl->powers ) {
+    size += PL_MAX_POWERS * sizeof(ProbabilityList *);
+    for ( i = 0; i < PL_MAX_POWERS; i++ ) {
+      if ( pl->powers[i] ) size += pl_memsize( pl->powers[i] );
+    }
+  }
+  if ( pl->dense ) size += pl_memsize( pl->dense );
+  if ( pl->given ) {
+    size += 2 * pl->slots * sizeof(ProbabilityList *);
+    for ( i = 0; i < 2 * pl->slots; i++ ) {
+      if ( pl->given[i] ) size += pl_memsize( pl->given[i] );
+    }
+  }
+  return size;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Compact storage. Queries read packed values directly, while calculations that create new
+//  distributions work on a double-precision copy, so precision is only lost once. The copy is
+//  temporary, except that repeat_sum and repeat_n_sum_k keep it to hold their caches.
+//
+
+int pl_compact( ProbabilityList *pl, int storage, ProbabilityList **result ) {
+  ProbabilityList *new_pl;
+  double max_p = 0.0;
+  double p;
+  int i;
+
+  if ( storage == PL_STORAGE_DOUBLE ) {
+    return pl_expand( pl, result );
+  }
+  if ( storage != PL_STORAGE_FLOAT32 && storage != PL_STORAGE_Q16 ) {
+    return GD_ERR_BAD_STORAGE;
+  }
+
+  new_pl = create_probability_list();
+  if ( new_pl == NULL ) return GD_ERR_NO_MEMORY;
+  new_pl->packed = malloc( pl->slots * packed_item_size( storage ) );
+  if ( new_pl->packed == NULL ) {
+    destroy_probability_list( new_pl );
+    return GD_ERR_NO_MEMORY;
+  }
+  new_pl->storage = storage;
+  new_pl->slots = pl->slots;
+  new_pl->offset = pl->offset;
+  new_pl->stride = pl->stride;
+
+  if ( storage == PL_STORAGE_FLOAT32 ) {
+    for ( i = 0; i < pl->slots; i++ ) {
+      ( (float *) new_pl->packed )[i] = (float) pl_prob( pl, i );
+    }
+  } else {
+    for ( i = 0; i < pl->slots; i++ ) {
+      p = pl_prob( pl, i );
+      if ( p > max_p ) max_p = p;
+    }
+    new_pl->packed_scale = max_p > 0.0 ? max_p / 65535.0 : 1.0;
+    for ( i = 0; i < pl->slots; i++ ) {
+      ( (uint16_t *) new_pl->packed )[i] = (uint16_t) ( pl_prob( pl, i ) / new_pl->packed_scale + 0.5 );
+    }
+  }
+
+  *result = new_pl;
+  return GD_OK;
+}
+
+// Double-precision copy of any distribution
+int pl_expand( ProbabilityList *pl, ProbabilityList **result ) {
+  ProbabilityList *new_pl;
+  int i, err;
+
+  if ( pl->storage == PL_STORAGE_DOUBLE ) {
+    return copy_probability_list( pl, result );
+  }
+  new_pl = create_probability_list();
+  if ( new_pl == NULL ) return GD_ERR_NO_MEMORY;
+  err = alloc_probs( new_pl, pl->slots );
+  if ( err ) {
+    destroy_probability_list( new_pl );
+    return err;
+  }
+  new_pl->offset = pl->offset;
+  new_pl->stride = pl->stride;
+  for ( i = 0; i < pl->slots; i++ ) {
+    new_pl->probs[i] = pl_prob( pl, i );
+  }
+  calc_cumulative( new_pl );
+  *result = new_pl;
+  return GD_OK;
+}
+
+// Double-precision version of pl for a calculation, which is pl itself unless it is compact or
+// a view. Release with pl_release_dense.
+static int pl_dense( ProbabilityList *pl, ProbabilityList **dense ) {
+  if ( pl->storage == PL_STORAGE_DOUBLE ) {
+    *dense = pl;
+    return GD_OK;
+  }
+  return pl_expand( pl, dense );
+}
+
+static void pl_release_dense( ProbabilityList *pl, ProbabilityList *dense ) {
+  if ( dense != pl ) destroy_probability_list( dense );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Probability List core "native" methods
+//
+
+int pl_min( ProbabilityList *pl ) {
+  return pl->offset;
+}
+
+int pl_max( ProbabilityList *pl ) {
+  return pl->offset + ( pl->slots - 1 ) * pl->stride;
+}
+
+// Stride to use when combining with other distributions, a single slot fits any stride
+static inline int pl_effective_stride( ProbabilityList *pl ) {
+  return pl->slots > 1 ? pl->stride : 0;
+}
+
+// Index of the highest slot with a result no more than target, may be negative
+static inline int pl_index_le( ProbabilityList *pl, int target ) {
+  int d = target - pl->offset;
+  if ( pl->stride == 1 || d >= 0 ) return d / pl->stride;
+  return -1 - ( -1 - d ) / pl->stride;
+}
+
+// Adding a fair die with w sides is a sliding window sum of width w, which takes time
+// proportional to the number of results whatever the size of the die. Below this size the direct
+// convolution is faster.
+#define PL_WINDOW_MIN_SIDES 12
+
+// Largest ratio between the peak total since a recompute and a result, before the result is
+// recomputed exactly
+#define PL_WINDOW_MAX_LOSS 16.0
+
+// Sum of x[lo..hi], clipped to 0..n-1
+static inline double window_exact( const double *x, int n, int lo, int hi ) {
+  double t = 0.0;
+  int j;
+  if ( lo < 0 ) lo = 0;
+  if ( hi > n - 1 ) hi = n - 1;
+  for ( j = lo; j <= hi; j++ ) t += x[j];
+  return t;
+}
+
+// Assigns out[k] = p * ( x[k-w+1] + ... + x[k] ) for each of the n + w - 1 results of adding a
+// fair w-sided die to x. A running total loses precision where it falls, as values subtracted are
+// larger than the total, so it is recomputed every w steps, and there are two passes. The
+// forward pass is accurate where totals rise and the backward pass where they fall, and each
+// result comes from the pass with the smaller peak total since its last recompute. Results that
+// are still much smaller than that peak, e.g. in a dip between two large values, are recomputed
+// exactly. That never happens for sums of fair dice, which rise and then fall.
+static int window_sum( const double *x, int n, int w, double p, double *out ) {
+  int m = n + w - 1;
+  double *bound;
+  double t = 0.0, peak = 0.0;
+  int k;
+
+  bound = malloc( m * sizeof(double) );
+  if ( bound == NULL ) return GD_ERR_NO_MEMORY;
+
+  for ( k = 0; k < m; k++ ) {
+    if ( k % w == 0 ) {
+      t = window_exact( x, n, k - w + 1, k );
+      peak = t;
+    } else {
+      if ( k < n ) t += x[k];
+      if ( k >= w ) t -= x[ k - w ];
+      if ( t < 0.0 ) t = 0.0;
+      if ( t > peak ) peak = t;
+    }
+    out[k] = t;
+    bound[k] = peak;
+  }
+
+  for ( k = m - 1; k >= 0; k-- ) {
+    if ( ( m - 1 - k ) % w == 0 ) {
+      t = window_exact( x, n, k - w + 1, k );
+      peak = t;
+    } else {
+      if ( k >= w - 1 ) t += x[ k - w + 1 ];
+      if ( k + 1 < n ) t -= x[ k + 1 ];
+      if ( t < 0.0 ) t = 0.0;
+      if ( t > peak ) peak = t;
+    }
+    if ( peak < bound[k] ) {
+      out[k] = t;
+      bound[k] = peak;
+    }
+    if ( bound[k] > PL_WINDOW_MAX_LOSS * out[k] ) {
+      out[k] = window_exact( x, n, k - w + 1, k );
+    }
+    out[k] *= p;
+  }
+
+  free( bound );
+  return GD_OK;
+}
+
+// Uniform distributions with results one apart, that can be added by window_sum
+static inline int pl_is_window( ProbabilityList *pl ) {
+  return pl->fair_dice == 1 && pl->slots >= PL_WINDOW_MIN_SIDES;
+}
+
+static int add_distributions_dense( ProbabilityList *pl_a, ProbabilityList *pl_b,
+    ProbabilityList **result ) {
+  double *pr;
+  ProbabilityList *pl;
+  int g = gd_gcd( pl_effective_stride( pl_a ), pl_effective_stride( pl_b ) );
+  int o = pl_a->offset + pl_b->offset;
+  int step_a, step_b, s, i, j, err;
+
+  // Convolution runs over slots that hold results, so summing e.g. a multiplied die with
+  // another distribution of the same stride costs no more than for stride 1
+  if ( g == 0 ) g = 1;
+  step_a = pl_a->stride / g;
+  step_b = pl_b->stride / g;
+  s = 1 + ( pl_a->slots - 1 ) * step_a + ( pl_b->slots - 1 ) * step_b;
+
+  err = new_basic_pl( s, 0.0, o, &pl );
+  if ( err ) return err;
+  pl->stride = g;
+  pr = pl->probs;
+  if ( step_a == 1 && step_b == 1 ) {
+    if ( pl_is_window( pl_b ) ) {
+      err = window_sum( pl_a->probs, pl_a->slots, pl_b->slots, pl_b->probs[0], pr );
+    } else if ( pl_is_window( pl_a ) ) {
+      err = window_sum( pl_b->probs, pl_b->slots, pl_a->slots, pl_a->probs[0], pr );
+    } else {
+      for ( i=0; i < pl_a->slots; i++ ) { for ( j=0; j < pl_b->slots; j++ ) {
+        pr[ i + j ] += (pl_a->probs)[i] * (pl_b->probs)[j];
+      } }
+    }
+    if ( err ) {
+      destroy_probability_list( pl );
+      return err;
+    }
+    if ( pl_a->fair_dice && pl_b->fair_dice && pl_a->fair_sides == pl_b->fair_sides ) {
+      pl->fair_dice = pl_a->fair_dice + pl_b->fair_dice;
+      pl->fair_sides = pl_a->fair_sides;
+    }
+  } else {
+    for ( i=0; i < pl_a->slots; i++ ) { for ( j=0; j < pl_b->slots; j++ ) {
+      pr[ i * step_a + j * step_b ] += (pl_a->probs)[i] * (pl_b->probs)[j];
+    } }
+  }
+  calc_cumulative( pl );
+  *result = pl;
+  return GD_OK;
+}
+
+int pl_add_distributions( ProbabilityList *pl_a, ProbabilityList *pl_b, ProbabilityList **result ) {
+  ProbabilityList *dense_a, *dense_b;
+  int err = pl_dense( pl_a, &dense_a );
+  if ( err ) return err;
+  err = pl_dense( pl_b, &dense_b );
+  if ( err ) {
+    pl_release_dense( pl_a, dense_a );
+    return err;
+  }
+  err = add_distributions_dense( dense_a, dense_b, result );
+  pl_release_dense( pl_b, dense_b );
+  pl_release_dense( pl_a, dense_a );
+  return err;
+}
+
+static int add_distributions_mult_dense( int mul_a, ProbabilityList *pl_a, int mul_b,
+    ProbabilityList *pl_b, ProbabilityList **result ) {
+  int pts[4] = {
+    mul_a * pl_min( pl_a ) + mul_b * pl_min( pl_b ),
+    mul_a * pl_max( pl_a ) + mul_b * pl_min( pl_b ),
+    mul_a * pl_min( pl_a ) + mul_b * pl_max( pl_b ),
+    mul_a * pl_max( pl_a ) + mul_b * pl_max( pl_b ) };
+
+  double *pr;
+  ProbabilityList *pl;
+  int combined_min = min( pts, 4 );
+  int combined_max = max( pts, 4 );
+  int g = gd_gcd( mul_a * pl_effective_stride( pl_a ), mul_b * pl_effective_stride( pl_b ) );
+  int s, i, j, err;
+
+  // Results of e.g. 10 x 1d6 are 10 apart, so only every 10th slot would be used at stride 1
+  if ( g == 0 ) g = 1;
+  s = 1 + ( combined_max - combined_min ) / g;
+
+  err = new_basic_pl( s, 0.0, combined_min, &pl );
+  if ( err ) return err;
+  pl->stride = g;
+  pr = pl->probs;
+  for ( i=0; i < pl_a->slots; i++ ) { for ( j=0; j < pl_b->slots; j++ ) {
+    int k = mul_a * ( pl_a->offset + i * pl_a->stride ) + mul_b * ( pl_b->offset + j * pl_b->stride )
+        - combined_min;
+    pr[ k / g ] += (pl_a->probs)[i] * (pl_b->probs)[j];
+  } }
+  calc_cumulative( pl );
+  *result = pl;
+  return GD_OK;
+}
+
+int pl_add_distributions_mult( int mul_a, ProbabilityList *pl_a, int mul_b, ProbabilityList *pl_b,
+    ProbabilityList **result ) {
+  ProbabilityList *dense_a, *dense_b;
+  int err = pl_dense( pl_a, &dense_a );
+  if ( err ) return err;
+  err = pl_dense( pl_b, &dense_b );
+  if ( err ) {
+    pl_release_dense( pl_a, dense_a );
+    return err;
+  }
+  err = add_distributions_mult_dense( mul_a, dense_a, mul_b, dense_b, result );
+  pl_release_dense( pl_b, dense_b );
+  pl_release_dense( pl_a, dense_a );
+  return err;
+}
+
+double pl_p_eql( ProbabilityList *pl, int target ) {
+  int d = target - pl->offset;
+  int idx = d / pl->stride;
+  if ( d < 0 || idx >= pl->slots || d % pl->stride ) {
+    return 0.0;
+  }
+  return pl_prob( pl, idx );
+}
+
+double pl_p_gt( ProbabilityList *pl, int target ) {
+  double *sv;
+  int idx = pl_index_le( pl, target );
+  if ( idx < 0 ) {
+    return 1.0;
+  }
+  if ( idx >= pl->slots - 1 ) {
+    return 0.0;
+  }
+  if ( pl->storage == PL_STORAGE_VIEW ) {
+    return pl_view_sum( pl, idx + 1, pl->slots - 1 );
+  }
+  if ( pl->storage != PL_STORAGE_DOUBLE ) {
+    return pl_packed_sum( pl, idx + 1, pl->slots - 1 );
+  }
+  sv = pl_survival( pl );
+  if ( sv == NULL ) {
+    // Less accurate, but still correct to within rounding
+    return 1.0 - (pl->cumulative)[idx];
+  }
+  return sv[ idx + 1 ];
+}
+
+double pl_p_lt( ProbabilityList *pl, int target ) {
+  return pl_p_le( pl, target - 1 );
+}
+
+double pl_p_le( ProbabilityList *pl, int target ) {
+  int idx = pl_index_le( pl, target );
+  if ( idx < 0 ) {
+    return 0.0;
+  }
+  if ( idx >= pl->slots - 1 ) {
+    return 1.0;
+  }
+  if ( pl->storage == PL_STORAGE_VIEW ) {
+    return pl_view_sum( pl, 0, idx );
+  }
+  if ( pl->storage != PL_STORAGE_DOUBLE ) {
+    return pl_packed_sum( pl, 0, idx );
+  }
+  return (pl->cumulative)[idx];
+}
+
+double pl_p_ge( ProbabilityList *pl, int target ) {
+  return pl_p_gt( pl, target - 1 );
+}
+
+double pl_expected( ProbabilityList *pl ) {
+  double t = 0.0;
+  int o = pl->offset;
+  int s = pl->slots;
+  int i;
+  for ( i = 0; i < s ; i++ ) {
+    t += ( o + i * pl->stride ) * pl_prob( pl, i );
+  }
+  return t;
+}
+
+// Assigns { p_greater, p_tie, p_less } for a result from pl_a compared to one from pl_b. Both
+// are read in order through pl_prob, upwards to total the results of pl_b below each result of
+// pl_a, then downwards for those above it. This takes time proportional to slots of pl_a plus
+// slots of pl_b and allocates nothing, for any storage mode.
+void pl_compare( ProbabilityList *pl_a, ProbabilityList *pl_b, double *buffer ) {
+  double g = 0.0, g_err = 0.0;
+  double t = 0.0, t_err = 0.0;
+  double l = 0.0, l_err = 0.0;
+  double below = 0.0, below_err = 0.0;
+  double above = 0.0, above_err = 0.0;
+  double p;
+  int i, j, r;
+
+  for ( i = 0, j = 0; i < pl_a->slots; i++ ) {
+    r = pl_a->offset + i * pl_a->stride;
+    while ( j < pl_b->slots && pl_b->offset + j * pl_b->stride < r ) {
+      neumaier_add( &below, &below_err, pl_prob( pl_b, j++ ) );
+    }
+    p = pl_prob( pl_a, i );
+    if ( p <= 0.0 ) continue;
+    neumaier_add( &g, &g_err, p * ( below + below_err ) );
+    if ( j < pl_b->slots && pl_b->offset + j * pl_b->stride == r ) {
+      neumaier_add( &t, &t_err, p * pl_prob( pl_b, j ) );
+    }
+  }
+
+  for ( i = pl_a->slots - 1, j = pl_b->slots - 1; i >= 0; i-- ) {
+    r = pl_a->offset + i * pl_a->stride;
+    while ( j >= 0 && pl_b->offset + j * pl_b->stride > r ) {
+      neumaier_add( &above, &above_err, pl_prob( pl_b, j-- ) );
+    }
+    p = pl_prob( pl_a, i );
+    if ( p <= 0.0 ) continue;
+    neumaier_add( &l, &l_err, p * ( above + above_err ) );
+  }
+
+  buffer[0] = g + g_err;
+  buffer[1] = t + t_err;
+  buffer[2] = l + l_err;
+  return;
+}
+
+static inline uint64_t fnv1a_add( uint64_t h, const void *data, size_t size ) {
+  const unsigned char *bytes = (const unsigned char *) data;
+  size_t i;
+  for ( i = 0; i < size; i++ ) {
+    h = ( h ^ bytes[i] ) * 1099511628211ULL;
+  }
+  return h;
+}
+
+// Index of the first slot from i with a non-zero probability, or pl->slots if none
+static inline int pl_next_nonzero( ProbabilityList *pl, int i ) {
+  while ( i < pl->slots && pl_prob( pl, i ) == 0.0 ) i++;
+  return i;
+}
+
+// 64-bit FNV-1a hash of each result with a non-zero probability, and that probability as read
+// back at full precision. Storage mode, stride and zero slots are not included, so a view hashes
+// the same as its expanded copy, and e.g. results stored 2 apart the same as with zeros between
+// them. Compact modes usually do not, because they round the probabilities.
+uint64_t pl_hash( ProbabilityList *pl ) {
+  uint64_t h = 14695981039346656037ULL;
+  int i, r;
+  double p;
+  for ( i = pl_next_nonzero( pl, 0 ); i < pl->slots; i = pl_next_nonzero( pl, i + 1 ) ) {
+    r = pl->offset + i * pl->stride;
+    p = pl_prob( pl, i );
+    h = fnv1a_add( h, &r, sizeof(int) );
+    h = fnv1a_add( h, &p, sizeof(double) );
+  }
+  return h;
+}
+
+// True if both distributions have the same results with exactly the same non-zero probabilities
+int pl_equal( ProbabilityList *pl_a, ProbabilityList *pl_b ) {
+  int i = pl_next_nonzero( pl_a, 0 );
+  int j = pl_next_nonzero( pl_b, 0 );
+  if ( pl_a == pl_b ) return 1;
+  while ( i < pl_a->slots && j < pl_b->slots ) {
+    if ( pl_a->offset + i * pl_a->stride != pl_b->offset + j * pl_b->stride ||
+        pl_prob( pl_a, i ) != pl_prob( pl_b, j ) ) {
+      return 0;
+    }
+    i = pl_next_nonzero( pl_a, i + 1 );
+    j = pl_next_nonzero( pl_b, j + 1 );
+  }
+  return i == pl_a->slots && j == pl_b->slots;
+}
+
+// Conditional distributions are views of pl, so take constant time and memory
+int pl_given_ge( ProbabilityList *pl, int target, ProbabilityList **result ) {
+  int m = pl_min( pl );
+  double p;
+  int o;
+
+  if ( m > target ) {
+    target = m;
+  }
+  p = pl_p_ge( pl, target );
+  if ( p <= 0.0 ) {
+    return GD_ERR_DIVIDE_BY_ZERO;
+  }
+  // First slot with a result of target or more
+  o = pl_index_le( pl, target - 1 ) + 1;
+  return pl_new_view( pl, o, pl->slots - o, 1.0 / p, result );
+}
+
+int pl_given_le( ProbabilityList *pl, int target, ProbabilityList **result ) {
+  int m = pl_max( pl );
+  double p;
+
+  if ( m < target ) {
+    target = m;
+  }
+  p = pl_p_le( pl, target );
+  if ( p <= 0.0 ) {
+    return GD_ERR_DIVIDE_BY_ZERO;
+  }
+  return pl_new_view( pl, 0, pl_index_le( pl, target ) + 1, 1.0 / p, result );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Cache of repeat_sum powers. Squaring dominates the cost of repeat_sum, and the same chain of
+//  squarings is needed for every n, so each distribution keeps the powers it has calculated. The
+//  cache is limited to PL_POWER_CACHE_SLOTS in total; when a new power does not fit, the smallest
+//  powers (which are the cheapest to recalculate) are evicted first.
+//
+//  Views and compact distributions keep an expanded copy to hold their cache, and repeat_n_sum_k
+//  keeps the conditional distribution for each pivot, which hold caches of their own.
+//
+
+static void pl_clear_given_cache( ProbabilityList *pl ) {
+  int i;
+  if ( pl->given == NULL ) return;
+  for ( i = 0; i < 2 * pl->slots; i++ ) {
+    destroy_probability_list( pl->given[i] );
+  }
+  free( pl->given );
+  pl->given = NULL;
+  pl->given_cache_slots = 0;
+  return;
+}
+
+void pl_clear_power_cache( ProbabilityList *pl ) {
+  int i;
+  pl_clear_given_cache( pl );
+  destroy_probability_list( pl->dense );
+  pl->dense = NULL;
+  if ( pl->powers == NULL ) return;
+  for ( i = 0; i < PL_MAX_POWERS; i++ ) {
+    if ( pl->powers[i] != NULL ) {
+      destroy_probability_list( pl->powers[i] );
+    }
+  }
+  free( pl->powers );
+  pl->powers = NULL;
+  pl->power_cache_slots = 0;
+  return;
+}
+
+// Double-precision version of pl for a calculation that caches results, which is kept on pl if it
+// fits the cache. Release with pl_release_dense.
+static int pl_dense_cached( ProbabilityList *pl, ProbabilityList **dense ) {
+  int err;
+  if ( pl->dense == NULL ) {
+    err = pl_dense( pl, dense );
+    if ( err || *dense == pl || ( *dense )->slots > PL_POWER_CACHE_SLOTS ) return err;
+    pl->dense = *dense;
+  }
+  *dense = pl->dense;
+  // Shared with the cache, so that pl_release_dense leaves it in place
+  ( *dense )->refs++;
+  return GD_OK;
+}
+
+// Distribution summed 2^p times, or NULL if not available. Result belongs to the cache.
+static ProbabilityList *pl_cached_power( ProbabilityList *pl, int p ) {
+  if ( p == 0 ) return pl;
+  if ( pl->powers == NULL || p > PL_MAX_POWERS ) return NULL;
+  return pl->powers[ p - 1 ];
+}
+
+// Returns 1 if the cache took ownership of pl_power, or 0 if caller should destroy it
+static int pl_cache_power( ProbabilityList *pl, int p, ProbabilityList *pl_power ) {
+  int i;
+  if ( p < 1 || p > PL_MAX_POWERS || pl_power->slots > PL_POWER_CACHE_SLOTS ) return 0;
+
+  if ( pl->powers == NULL ) {
+    pl->powers = calloc( PL_MAX_POWERS, sizeof(ProbabilityList *) );
+    if ( pl->powers == NULL ) return 0;
+  }
+
+  for ( i = 0; i < PL_MAX_POWERS && pl->power_cache_slots + pl_power->slots > PL_POWER_CACHE_SLOTS; i++ ) {
+    if ( pl->powers[i] != NULL ) {
+      pl->power_cache_slots -= pl->powers[i]->slots;
+      destroy_probability_list( pl->powers[i] );
+      pl->powers[i] = NULL;
+    }
+  }
+
+  pl->powers[ p - 1 ] = pl_power;
+  pl->power_cache_slots += pl_power->slots;
+  return 1;
+}
+
+static int repeat_sum_dense( ProbabilityList *pl, int n, ProbabilityList **result ) {
+  ProbabilityList *pd_power = NULL;
+  ProbabilityList *pd_result = NULL;
+  ProbabilityList *pd_next = NULL;
+  int power = 1;
+  int p = 0;
+  int own_power = 0;
+  int err = GD_OK;
+
+  pd_power = pl;
+
+  while ( 1 ) {
+    if ( power & n ) {
+      if ( pd_result ) {
+        err = pl_add_distributions( pd_result, pd_power, &pd_next );
+        if ( err ) break;
+        destroy_probability_list( pd_result );
+        pd_result = pd_next;
+      } else {
+        err = copy_probability_list( pd_power, &pd_result );
+        if ( err ) break;
+      }
+    }
+    power = power << 1;
+    if ( power > n ) break;
+    p++;
+    pd_next = pl_cached_power( pl, p );
+    if ( pd_next == NULL ) {
+      err = pl_add_distributions( pd_power, pd_power, &pd_next );
+      if ( err ) break;
+      if ( own_power ) destroy_probability_list( pd_power );
+      own_power = ! pl_cache_power( pl, p, pd_next );
+    } else if ( own_power ) {
+      destroy_probability_list( pd_power );
+      own_power = 0;
+    }
+    pd_power = pd_next;
+  }
+  if ( own_power ) destroy_probability_list( pd_power );
+
+  if ( err ) {
+    destroy_probability_list( pd_result );
+    return err;
+  }
+  *result = pd_result;
+  return GD_OK;
+}
+
+// Caches a copy of the sum of 2^p times pl held in probs, unless that power is already cached
+static int pl_cache_window_power( ProbabilityList *pl, int p, const double *probs ) {
+  ProbabilityList *pl_power;
+  int slots = ( ( pl->slots - 1 ) << p ) + 1;
+  int err;
+
+  if ( pl_cached_power( pl, p ) != NULL ) return GD_OK;
+  err = new_basic_pl( slots, 0.0, pl->offset << p, &pl_power );
+  if ( err ) return err;
+  memcpy( pl_power->probs, probs, slots * sizeof(double) );
+  calc_cumulative( pl_power );
+  pl_power->fair_dice = pl->fair_dice << p;
+  pl_power->fair_sides = pl->fair_sides;
+  if ( ! pl_cache_power( pl, p, pl_power ) ) destroy_probability_list( pl_power );
+  return GD_OK;
+}
+
+// Sum of n times pl, a sum of large fair dice, adding one die at a time with window_sum. Adding a
+// die costs time proportional to the results so far, which is less than adding any two of the
+// cached powers. The sum starts from the largest cached power of pl that is no more than n, and
+// powers passed on the way are cached, so e.g. repeat_sum for each n up to some limit reuses
+// earlier work.
+static int repeat_sum_window( ProbabilityList *pl, int n, ProbabilityList **result ) {
+  ProbabilityList *start = pl;
+  ProbabilityList *sum;
+  double *from, *to, *swap;
+  int dice = pl->fair_dice;
+  int sides = pl->fair_sides;
+  int p_start = 0;
+  int p, len, d, err;
+
+  for ( p = 1; p <= PL_MAX_POWERS && ( n >> p ) > 0; p++ ) {
+    if ( pl_cached_power( pl, p ) != NULL ) {
+      start = pl_cached_power( pl, p );
+      p_start = p;
+    }
+  }
+  p = p_start + 1;
+
+  err = new_basic_pl( n * ( pl->slots - 1 ) + 1, 0.0, n * pl->offset, &sum );
+  if ( err ) return err;
+
+  // The cumulative array is spare until the end, so holds alternate steps
+  from = sum->probs;
+  to = sum->cumulative;
+  memcpy( from, start->probs, start->slots * sizeof(double) );
+  len = start->slots;
+  for ( d = ( dice << p_start ) + 1; d <= n * dice && err == GD_OK; d++, len += sides - 1 ) {
+    err = window_sum( from, len, sides, 1.0 / sides, to );
+    swap = from;
+    from = to;
+    to = swap;
+    if ( err == GD_OK && d == dice << p ) {
+      err = pl_cache_window_power( pl, p++, from );
+    }
+  }
+  if ( err ) {
+    destroy_probability_list( sum );
+    return err;
+  }
+  if ( from != sum->probs ) {
+    memcpy( sum->probs, from, sum->slots * sizeof(double) );
+  }
+  calc_cumulative( sum );
+  sum->fair_dice = n * dice;
+  sum->fair_sides = sides;
+  *result = sum;
+  return GD_OK;
+}
+
+// Views and compact distributions are summed via an expanded copy, which keeps cached powers
+int pl_repeat_sum( ProbabilityList *pl, int n, ProbabilityList **result ) {
+  ProbabilityList *dense;
+  int err;
+
+  if ( n < 1 ) {
+    return GD_ERR_N_TOO_SMALL;
+  }
+  if ( n * pl->slots - n >  PL_MAX_SLOTS ) {
+    return GD_ERR_TOO_MANY_SLOTS;
+  }
+  err = pl_dense_cached( pl, &dense );
+  if ( err ) return err;
+  if ( dense->fair_dice && dense->fair_sides >= PL_WINDOW_MIN_SIDES && dense->stride == 1 ) {
+    err = repeat_sum_window( dense, n, result );
+  } else {
+    err = repeat_sum_dense( dense, n, result );
+  }
+  pl_release_dense( pl, dense );
+  return err;
+}
+
+// Sum of n fair dice, with results n to n * sides. Large dice are added one at a time with
+// window_sum, which takes time proportional to n * n * sides, against n * n * sides * sides
+// for repeat_sum. Small dice use repeat_sum.
+int pl_fair_dice( int n, int sides, ProbabilityList **result ) {
+  ProbabilityList *pl;
+  int err;
+
+  if ( n < 1 ) {
+    return GD_ERR_N_TOO_SMALL;
+  }
+  if ( sides < 1 ) {
+    return GD_ERR_BAD_SLOTS;
+  }
+  if ( (long long) n * ( sides - 1 ) + 1 > PL_MAX_SLOTS ) {
+    return GD_ERR_TOO_MANY_SLOTS;
+  }
+
+  err = new_basic_pl( sides, 1.0 / sides, 1, &pl );
+  if ( err ) return err;
+  pl->fair_dice = 1;
+  pl->fair_sides = sides;
+  if ( n == 1 ) {
+    *result = pl;
+    return GD_OK;
+  }
+  err = pl_repeat_sum( pl, n, result );
+  destroy_probability_list( pl );
+  return err;
+}
+
+// Assigns { p_rejected, p_maybe, p_kept } to buffer
+static void calc_p_table( ProbabilityList *pl, int q, int kbest, double *buffer ) {
+  if ( kbest ) {
+    buffer[2] = pl_p_gt( pl, q );
+    buffer[1] = pl_p_eql( pl, q );
+    buffer[0] = pl_p_lt( pl, q );
+  } else {
+    buffer[2] = pl_p_lt( pl, q );
+    buffer[1] = pl_p_eql( pl, q );
+    buffer[0] = pl_p_gt( pl, q );
+  }
+  return;
+}
+
+static void clear_pl_array( int k, ProbabilityList **pl_array  ) {
+  int n;
+  for ( n=0; n<k; n++) {
+    if ( pl_array[n] != NULL ) {
+      destroy_probability_list( pl_array[n] );
+      pl_array[n] = NULL;
+    }
+  }
+  return;
+}
+
+// Assigns a list of pl variants to a buffer
+// Expanded distribution of results above (kbest) or below q, kept in pl's cache so that its
+// cached powers are reused by later pivots' calls and later calls to repeat_n_sum_k. NULL if no
+// result is above or below q. Result belongs to the cache, unless *owned is set.
+static int pl_given_dense( ProbabilityList *pl, int q, int kbest, ProbabilityList **result, int *owned ) {
+  ProbabilityList *view = NULL;
+  int i = ( q - pl->offset ) / pl->stride;
+  int err = GD_OK;
+
+  *result = NULL;
+  *owned = 0;
+  if ( pl->given && pl->given[ kbest * pl->slots + i ] ) {
+    *result = pl->given[ kbest * pl->slots + i ];
+    return GD_OK;
+  }
+  if ( kbest ) {
+    if ( pl_p_gt( pl, q ) > 0.0 ) {
+      err = pl_given_ge( pl, q + 1, &view );
+    }
+  } else {
+    if ( pl_p_lt( pl, q ) > 0.0 ) {
+      err = pl_given_le( pl, q - 1, &view );
+    }
+  }
+  if ( err || view == NULL ) return err;
+  err = pl_expand( view, result );
+  destroy_probability_list( view );
+  if ( err ) return err;
+
+  if ( pl->given == NULL ) {
+    pl->given = calloc( 2 * pl->slots, sizeof(ProbabilityList *) );
+  }
+  if ( pl->given == NULL ) {
+    *owned = 1;
+  } else {
+    pl->given[ kbest * pl->slots + i ] = *result;
+    pl->given_cache_slots += ( *result )->slots;
+  }
+  return GD_OK;
+}
+
+static int calc_keep_distributions( ProbabilityList *pl, int k, int q, int kbest, ProbabilityList **pl_array ) {
+  ProbabilityList *pl_kd = NULL;
+  int n, owned, cached_slots;
+  int err = GD_OK;
+
+  for ( n=0; n<k; n++) { pl_array[n] = NULL; }
+  err = new_basic_pl( 1, 1.0, q * k, &pl_array[0] );
+  if ( err ) return err;
+  if ( k < 2 ) return GD_OK;
+
+  err = pl_given_dense( pl, q, kbest, &pl_kd, &owned );
+  if ( err || pl_kd == NULL ) return err;
+
+  cached_slots = pl_kd->power_cache_slots;
+  for ( n = 1; n < k; n++ ) {
+    err = pl_repeat_sum( pl_kd, n, &pl_array[n] );
+    if ( err ) break;
+    (pl_array[n])->offset += q * ( k - n );
+  }
+  if ( owned ) {
+    destroy_probability_list( pl_kd );
+  } else {
+    // Powers cached on pl_kd count towards pl's limit, which is kept by starting again
+    pl->given_cache_slots += pl_kd->power_cache_slots - cached_slots;
+    if ( pl->given_cache_slots > PL_POWER_CACHE_SLOTS ) pl_clear_given_cache( pl );
+  }
+
+  return err;
+}
+
+static int repeat_n_sum_k_dense( ProbabilityList *pl, int n, int k, int kbest,
+    ProbabilityList **result ) {
+  // Table of probabilities ( reject, maybe, keep ) for each "pivot point"
+  double p_table[3];
+  int keep_combos[3];
+  // Table of distributions for each count of > pivot point (vs == pivot point)
+  ProbabilityList *keep_distributions[PL_MAX_KEEP_DICE + 1];
+  ProbabilityList *kd;
+  ProbabilityList *pl_result = NULL;
+
+  double *pr;
+  int d = n - k;
+  int i, j, q, dn, kn, mn, kdq, err;
+  double p_sequence;
+
+  if ( n < 1 ) {
+    return GD_ERR_N_TOO_SMALL;
+  }
+  if ( k < 1 ) {
+    return GD_ERR_K_TOO_SMALL;
+  }
+  if ( k >= n ) {
+    return pl_repeat_sum( pl, n, result );
+  }
+  if ( k * pl->slots - k >= PL_MAX_SLOTS ) {
+    return GD_ERR_TOO_MANY_SLOTS;
+  }
+  if ( n > PL_MAX_KEEP_DICE ) {
+    return GD_ERR_TOO_MANY_DICE;
+  }
+
+  // Init target
+  err = new_basic_pl( 1 + k * (pl->slots - 1), 0.0, pl->offset * k, &pl_result );
+  if ( err ) return err;
+  pl_result->stride = pl->stride;
+  pr = pl_result->probs;
+
+  for ( i = 0; i < pl->slots; i++ ) {
+    if ( pl->probs[i] <= 0.0 ) continue;
+
+    q = pl->offset + i * pl->stride;
+    err = calc_keep_distributions( pl, k, q, kbest, keep_distributions );
+    if ( err ) {
+      clear_pl_array( k, keep_distributions );
+      destroy_probability_list( pl_result );
+      return err;
+    }
+    calc_p_table( pl, q, kbest, p_table );
+
+    for ( kn = 0; kn < k; kn++ ) {
+      // Construct keepers. maybes, discards (just counts of these) . . .
+      if ( kn > 0 && ! ( p_table[2] > 0.0 ) ) continue;
+
+      for ( dn = 0; dn <= d; dn++ ) {
+        mn = (k - kn) + ( d - dn );
+        if ( dn > 0 && ! ( p_table[0] > 0.0 ) ) continue;
+        p_sequence = 1.0;
+        for ( j = 0; j < dn; j++ ) { p_sequence *= p_table[0]; }
+        for ( j = 0; j < mn; j++ ) { p_sequence *= p_table[1]; }
+        for ( j = 0; j < kn; j++ ) { p_sequence *= p_table[2]; }
+        keep_combos[0] = dn;
+        keep_combos[1] = mn;
+        keep_combos[2] = kn;
+        p_sequence *= num_arrangements( keep_combos, 3 );
+        kd = keep_distributions[ kn ];
+
+        for ( j = 0; j < kd->slots; j++ ) {
+          kdq = kd->offset + j * kd->stride;
+          pr[ ( kdq - pl_result->offset ) / pl_result->stride ] += p_sequence * kd->probs[ j ];
+        }
+      }
+    }
+    clear_pl_array( k, keep_distributions );
+  }
+
+  calc_cumulative( pl_result );
+  *result = pl_result;
+  return GD_OK;
+}
+
+int pl_repeat_n_sum_k( ProbabilityList *pl, int n, int k, int kbest, ProbabilityList **result ) {
+  ProbabilityList *dense;
+  int err = pl_dense_cached( pl, &dense );
+  if ( err ) return err;
+  err = repeat_n_sum_k_dense( dense, n, k, kbest, result );
+  pl_release_dense( pl, dense );
+  return err;
+}
@@ -0,0 +1,165 @@
+// ext/games_dice/core/probability_list.h
+
+// Public interface to the games_dice distribution kernels. Nothing here depends on Ruby, so the
+// static library built by core/Makefile can be linked into other programs. Functions that can
+// fail return one of the GD_* error codes, and pass any new distribution back via a pointer.
+
+#ifndef GD_PROBABILITY_LIST_H
+#define GD_PROBABILITY_LIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest number of results in a single distribution
+#define PL_MAX_SLOTS 1000000
+
+// Maximum total slots held in each of a distribution's caches (repeat_sum powers, and the
+// conditional distributions used by repeat_n_sum_k), 512KB of doubles. This covers the powers
+// needed for typical dice pools, while many distributions can be held long-term
+#define PL_POWER_CACHE_SLOTS 65536
+
+// Number of cacheable powers, enough for any n allowed by repeat_sum
+#define PL_MAX_POWERS 31
+
+// Largest n in repeat_n_sum_k, limited by factorials that fit in a double
+#define PL_MAX_KEEP_DICE 170
+
+#define GD_OK 0
+#define GD_ERR_NO_MEMORY 1
+#define GD_ERR_BAD_SLOTS 2
+#define GD_ERR_BAD_PROBABILITY 3
+#define GD_ERR_TOO_MANY_SLOTS 4
+#define GD_ERR_DIVIDE_BY_ZERO 5
+#define GD_ERR_N_TOO_SMALL 6
+#define GD_ERR_K_TOO_SMALL 7
+#define GD_ERR_TOO_MANY_DICE 8
+#define GD_ERR_BAD_STORAGE 9
+#define GD_ERR_IO 10
+#define GD_ERR_BAD_FILE 11
+#define GD_ERR_NOT_SUPPORTED 12
+#define GD_ERR_INTERRUPTED 13
+
+// Storage modes. Compact modes keep one packed array instead of probs and cumulative, and are
+// intended for finished distributions that are held for a long time, see pl_compact.
+//   PL_STORAGE_FLOAT32 - 4 bytes per result, each probability (and so every sum of them) is
+//                        within a relative 2^-24 (about 6e-8) of the double value, for values
+//                        above 1e-38
+//   PL_STORAGE_Q16     - 2 bytes per result, quantized to 0..65535 times a scale of
+//                        (largest probability / 65535), so each probability is within an
+//                        absolute (largest probability / 131070), and values below that may
+//                        read as zero
+#define PL_STORAGE_DOUBLE 0
+#define PL_STORAGE_FLOAT32 1
+#define PL_STORAGE_Q16 2
+
+// Results of given_ge and given_le are views, a rescaled range of slots from another
+// distribution. They share its arrays instead of copying them, and are expanded into a double
+// precision copy only when used in a calculation that creates a new distribution.
+#define PL_STORAGE_VIEW 3
+
+typedef struct _pd {
+    // Result at index i is offset + i * stride. Stride is greater than 1 when possible results
+    // are spaced out, e.g. multiplied dice, and is ignored when there is only one slot
+    int offset;
+    int stride;
+    int slots;
+    double *probs;
+    double *cumulative;
+    // survival[i] is total probability of index i or higher, built on first upper-tail query
+    double *survival;
+    // powers[i] is this distribution summed with itself 2^(i+1) times, or NULL if not cached
+    struct _pd **powers;
+    int power_cache_slots;
+    // Expanded copy of a view or compact distribution, kept so that repeat_sum and
+    // repeat_n_sum_k can cache calculations on it, or NULL
+    struct _pd *dense;
+    // given[ kbest * slots + i ] is the distribution of results above (kbest) or below slot i,
+    // used by repeat_n_sum_k along with its own cached powers, or NULL. given_cache_slots
+    // counts slots in these and their powers
+    struct _pd **given;
+    int given_cache_slots;
+    // One of the PL_STORAGE_* modes. For compact modes, probs, cumulative, survival and powers
+    // are all NULL, and values are read from packed (as float or uint16_t times packed_scale)
+    int storage;
+    void *packed;
+    double packed_scale;
+    // For views, slot i is slot view_start + i of parent, times view_scale. Parent is never
+    // itself a view, and is kept alive by a reference count
+    struct _pd *parent;
+    int view_start;
+    double view_scale;
+    // Distribution is known to be the sum of fair_dice dice, each with fair_sides equally likely
+    // results one apart, or fair_dice is 0. Sums with these use sliding-window kernels
+    int fair_dice;
+    int fair_sides;
+    // Owners of this distribution, destroy_probability_list only frees it when the last one
+    // is done. Not thread-safe
+    int refs;
+    // Bytes last reported to a host garbage collector, maintained by language bindings
+    size_t host_memsize;
+  } ProbabilityList;
+
+const char *gd_error_message( int err );
+
+int gd_gcd( int a, int b );
+
+ProbabilityList *create_probability_list();
+
+void destroy_probability_list( ProbabilityList *pl );
+
+int alloc_probs( ProbabilityList *pl, int slots );
+
+int alloc_probs_iv( ProbabilityList *pl, int slots, double iv );
+
+int copy_probability_list( ProbabilityList *orig, ProbabilityList **result );
+
+int new_basic_pl( int nslots, double iv, int o, ProbabilityList **result );
+
+int pl_fair_dice( int n, int sides, ProbabilityList **result );
+
+double calc_cumulative( ProbabilityList *pl );
+
+void pl_clear_power_cache( ProbabilityList *pl );
+
+size_t pl_memsize( ProbabilityList *pl );
+
+int pl_compact( ProbabilityList *pl, int storage, ProbabilityList **result );
+
+int pl_expand( ProbabilityList *pl, ProbabilityList **result );
+
+int pl_min( ProbabilityList *pl );
+
+int pl_max( ProbabilityList *pl );
+
+int pl_add_distributions( ProbabilityList *pl_a, ProbabilityList *pl_b, ProbabilityList **result );
+
+int pl_add_distributions_mult( int mul_a, ProbabilityList *pl_a, int mul_b, ProbabilityList *pl_b,
+    ProbabilityList **result );
+
+double pl_p_eql( ProbabilityList *pl, int target );
+
+double pl_p_gt( ProbabilityList *pl, int target );
+
+double pl_p_lt( ProbabilityList *pl, int target );
+
+double pl_p_le( ProbabilityList *pl, int target );
+
+double pl_p_ge( ProbabilityList *pl, int target );
+
+double pl_expected( ProbabilityList *pl );
+
+void pl_compare( ProbabilityList *pl_a, ProbabilityList *pl_b, double *buffer );
+
+uint64_t pl_hash( ProbabilityList *pl );
+
+int pl_equal( ProbabilityList *pl_a, ProbabilityList *pl_b );
+
+int pl_given_ge( ProbabilityList *pl, int target, ProbabilityList **result );
+
+int pl_given_le( ProbabilityList *pl, int target, ProbabilityList **result );
+
+int pl_repeat_sum( ProbabilityList *pl, int n, ProbabilityList **result );
+
+int pl_repeat_n_sum_k( ProbabilityList *pl, int n, int k, int kbest, ProbabilityList **result );
+
+#endif
@@ -0,0 +1,679 @@
+// ext/games_dice/core/test_probability_list.c
+
+// Native tests for the distribution kernels, run with "make test". These cover behaviour that
+// the Ruby specs cannot see directly, such as error codes and memory ownership, and are intended
+// to be run under valgrind or sanitizers too.
+
+#define _XOPEN_SOURCE 700
+
+#include "probability_list.h"
+#include "mapped_probability_list.h"
+#include <stdio.h>
+#include <math.h>
+#include <sys/stat.h>
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK( cond ) do { \
+    checks++; \
+    if ( ! ( cond ) ) { \
+      failures++; \
+      fprintf( stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond ); \
+    } \
+  } while ( 0 )
+
+#define CHECK_NEAR( a, b, tol ) CHECK( fabs( (a) - (b) ) <= (tol) )
+
+static ProbabilityList *fair_die( int sides ) {
+  ProbabilityList *pl = NULL;
+  CHECK( new_basic_pl( sides, 1.0 / sides, 1, &pl ) == GD_OK );
+  return pl;
+}
+
+static void test_basic_queries() {
+  ProbabilityList *d6 = fair_die( 6 );
+  CHECK( pl_min( d6 ) == 1 );
+  CHECK( pl_max( d6 ) == 6 );
+  CHECK_NEAR( pl_p_eql( d6, 3 ), 1.0 / 6, 1e-15 );
+  CHECK( pl_p_eql( d6, 7 ) == 0.0 );
+  CHECK_NEAR( pl_p_le( d6, 2 ), 2.0 / 6, 1e-15 );
+  CHECK_NEAR( pl_p_lt( d6, 2 ), 1.0 / 6, 1e-15 );
+  CHECK_NEAR( pl_p_ge( d6, 5 ), 2.0 / 6, 1e-15 );
+  CHECK_NEAR( pl_p_gt( d6, 5 ), 1.0 / 6, 1e-15 );
+  CHECK( pl_p_ge( d6, 1 ) == 1.0 );
+  CHECK( pl_p_gt( d6, 6 ) == 0.0 );
+  CHECK_NEAR( pl_expected( d6 ), 3.5, 1e-15 );
+  destroy_probability_list( d6 );
+}
+
+static void test_add_distributions() {
+  ProbabilityList *d6 = fair_die( 6 );
+  ProbabilityList *sum = NULL;
+  ProbabilityList *diff = NULL;
+  double cmp[3];
+
+  CHECK( pl_add_distributions( d6, d6, &sum ) == GD_OK );
+  CHECK( pl_min( sum ) == 2 );
+  CHECK( pl_max( sum ) == 12 );
+  CHECK_NEAR( pl_p_eql( sum, 7 ), 6.0 / 36, 1e-15 );
+
+  CHECK( pl_add_distributions_mult( 1, d6, -1, d6, &diff ) == GD_OK );
+  CHECK( pl_min( diff ) == -5 );
+  CHECK( pl_max( diff ) == 5 );
+  CHECK_NEAR( pl_p_eql( diff, 0 ), 6.0 / 36, 1e-15 );
+
+  pl_compare( d6, d6, cmp );
+  CHECK_NEAR( cmp[0], 15.0 / 36, 1e-15 );
+  CHECK_NEAR( cmp[1], 6.0 / 36, 1e-15 );
+  CHECK_NEAR( cmp[2], 15.0 / 36, 1e-15 );
+
+  destroy_probability_list( d6 );
+  destroy_probability_list( sum );
+  destroy_probability_list( diff );
+}
+
+static void test_repeat_sum() {
+  ProbabilityList *d10 = fair_die( 10 );
+  ProbabilityList *pl = NULL;
+  ProbabilityList *again = NULL;
+  size_t uncached_size = pl_memsize( d10 );
+  int n;
+
+  // Exact count of ways to roll 95 or more on 10d10 is 3003
+  CHECK( pl_repeat_sum( d10, 10, &pl ) == GD_OK );
+  CHECK( fabs( pl_p_ge( pl, 95 ) / 3003e-10 - 1.0 ) < 1e-12 );
+  destroy_probability_list( pl );
+
+  // Sweeping n reuses cached powers, results should not change
+  for ( n = 1; n <= 40; n++ ) {
+    CHECK( pl_repeat_sum( d10, n, &pl ) == GD_OK );
+    CHECK( pl_max( pl ) == 10 * n );
+    CHECK_NEAR( pl_expected( pl ), 5.5 * n, 1e-9 * n );
+    destroy_probability_list( pl );
+  }
+  CHECK( d10->powers != NULL );
+  CHECK( pl_memsize( d10 ) > uncached_size + 320 * sizeof(double) );
+  CHECK( pl_repeat_sum( d10, 37, &again ) == GD_OK );
+  CHECK_NEAR( pl_p_eql( again, 200 ), pl_p_eql( again, 207 ), 1e-15 );
+  destroy_probability_list( again );
+
+  destroy_probability_list( d10 );
+}
+
+// Near either end of n dice with s sides, there are C( k + n - 1, n - 1 ) ways to be k from the
+// end, for k < s. Both tails should keep full relative precision.
+static void check_fair_tails( ProbabilityList *pl, int n, int s ) {
+  double ways = 1.0;
+  double all = pow( (double) s, n );
+  int k;
+  for ( k = 0; k < s; k++ ) {
+    if ( k > 0 ) ways = ways * ( k + n - 1 ) / k;
+    CHECK( fabs( pl_p_eql( pl, n + k ) * all / ways - 1.0 ) < 1e-12 );
+    CHECK( fabs( pl_p_eql( pl, n * s - k ) * all / ways - 1.0 ) < 1e-12 );
+  }
+}
+
+static void test_fair_dice() {
+  ProbabilityList *d100 = fair_die( 100 );
+  ProbabilityList *uneven = NULL;
+  ProbabilityList *pl = NULL;
+  ProbabilityList *fast = NULL;
+  ProbabilityList *slow = NULL;
+  ProbabilityList *tagged = NULL;
+  ProbabilityList *d20;
+  int n, t;
+
+  for ( n = 1; n <= 12; n++ ) {
+    CHECK( pl_fair_dice( n, 100, &fast ) == GD_OK );
+    CHECK( fast->fair_dice == n && fast->fair_sides == 100 );
+    CHECK( pl_min( fast ) == n && pl_max( fast ) == 100 * n );
+    check_fair_tails( fast, n, 100 );
+    CHECK( pl_repeat_sum( d100, n, &slow ) == GD_OK );
+    for ( t = n; t <= 100 * n; t += 7 ) {
+      CHECK( fabs( pl_p_eql( fast, t ) - pl_p_eql( slow, t ) ) <= 1e-13 * pl_p_eql( slow, t ) );
+    }
+    destroy_probability_list( slow );
+    destroy_probability_list( fast );
+  }
+
+  // Small dice use repeat_sum, but keep the tags
+  CHECK( pl_fair_dice( 20, 6, &fast ) == GD_OK );
+  CHECK( fast->fair_dice == 20 && fast->fair_sides == 6 );
+  check_fair_tails( fast, 20, 6 );
+  CHECK( pl_repeat_sum( fast, 3, &pl ) == GD_OK );
+  CHECK( pl->fair_dice == 60 && pl_max( pl ) == 360 );
+  destroy_probability_list( pl );
+  destroy_probability_list( fast );
+
+  // Tagged distributions repeat and add via windows
+  CHECK( pl_fair_dice( 1, 1000, &fast ) == GD_OK );
+  CHECK( pl_repeat_sum( fast, 30, &pl ) == GD_OK );
+  CHECK( pl->fair_dice == 30 && pl_min( pl ) == 30 && pl_max( pl ) == 30000 );
+  check_fair_tails( pl, 30, 1000 );
+  CHECK( fast->powers != NULL && fast->powers[3] != NULL && fast->powers[3]->fair_dice == 16 );
+  destroy_probability_list( pl );
+
+  // Sweeping n starts from cached powers, results should not change
+  d20 = fair_die( 20 );
+  CHECK( pl_fair_dice( 1, 20, &tagged ) == GD_OK );
+  for ( n = 1; n <= 40; n++ ) {
+    CHECK( pl_repeat_sum( tagged, n, &pl ) == GD_OK );
+    CHECK( pl->fair_dice == n && pl_min( pl ) == n && pl_max( pl ) == 20 * n );
+    check_fair_tails( pl, n, 20 );
+    CHECK( pl_repeat_sum( d20, n, &slow ) == GD_OK );
+    for ( t = n; t <= 20 * n; t += 3 ) {
+      CHECK( fabs( pl_p_eql( pl, t ) - pl_p_eql( slow, t ) ) <= 1e-12 * pl_p_eql( slow, t ) );
+    }
+    destroy_probability_list( slow );
+    destroy_probability_list( pl );
+  }
+  CHECK( tagged->powers[4] != NULL && tagged->powers[4]->fair_dice == 32 );
+  CHECK( pl_max( tagged->powers[4] ) == 640 );
+  destroy_probability_list( tagged );
+  destroy_probability_list( d20 );
+
+  // A window over a dip between two large values, against the direct convolution
+  uneven = create_probability_list();
+  CHECK( alloc_probs( uneven, 3000 ) == GD_OK );
+  for ( t = 0; t < 3000; t++ ) {
+    uneven->probs[t] = t < 1000 || t >= 2000 ? ( 0.5 - 5e-10 ) / 1000 : 1e-12 * ( 1 + t % 3 );
+  }
+  calc_cumulative( uneven );
+  CHECK( pl_add_distributions( uneven, fast, &pl ) == GD_OK );
+  CHECK( pl->fair_dice == 0 );
+  destroy_probability_list( fast );
+  fast = fair_die( 1000 );
+  CHECK( pl_add_distributions( uneven, fast, &slow ) == GD_OK );
+  for ( t = pl_min( pl ); t <= pl_max( pl ); t++ ) {
+    CHECK( fabs( pl_p_eql( pl, t ) - pl_p_eql( slow, t ) ) <= 1e-12 * pl_p_eql( slow, t ) );
+  }
+  destroy_probability_list( slow );
+  destroy_probability_list( pl );
+  destroy_probability_list( uneven );
+  destroy_probability_list( fast );
+
+  CHECK( pl_fair_dice( 0, 6, &pl ) == GD_ERR_N_TOO_SMALL );
+  CHECK( pl_fair_dice( 3, 0, &pl ) == GD_ERR_BAD_SLOTS );
+  CHECK( pl_fair_dice( 1002, 1000, &pl ) == GD_ERR_TOO_MANY_SLOTS );
+
+  destroy_probability_list( d100 );
+}
+
+static void test_repeat_n_sum_k() {
+  ProbabilityList *d6 = fair_die( 6 );
+  ProbabilityList *pl = NULL;
+
+  CHECK( pl_repeat_n_sum_k( d6, 4, 3, 1, &pl ) == GD_OK );
+  CHECK( pl_min( pl ) == 3 );
+  CHECK( pl_max( pl ) == 18 );
+  CHECK_NEAR( pl_p_eql( pl, 18 ), 21.0 / 1296, 1e-15 );
+  CHECK_NEAR( pl_expected( pl ), 15869.0 / 1296, 1e-12 );
+  destroy_probability_list( pl );
+
+  CHECK( pl_repeat_n_sum_k( d6, 2, 1, 0, &pl ) == GD_OK );
+  CHECK_NEAR( pl_p_eql( pl, 1 ), 11.0 / 36, 1e-15 );
+  destroy_probability_list( pl );
+
+  // Conditional distributions for each pivot are kept, and reused by later calls
+  CHECK( d6->given != NULL && d6->given[6 + 2] != NULL );
+  CHECK( d6->given[6 + 2]->powers != NULL );
+  CHECK( pl_repeat_n_sum_k( d6, 4, 3, 1, &pl ) == GD_OK );
+  CHECK_NEAR( pl_p_eql( pl, 18 ), 21.0 / 1296, 1e-15 );
+  CHECK_NEAR( pl_expected( pl ), 15869.0 / 1296, 1e-12 );
+  destroy_probability_list( pl );
+
+  destroy_probability_list( d6 );
+}
+
+static void test_given() {
+  ProbabilityList *d6 = fair_die( 6 );
+  ProbabilityList *pl = NULL;
+
+  CHECK( pl_given_ge( d6, 5, &pl ) == GD_OK );
+  CHECK( pl_min( pl ) == 5 );
+  CHECK_NEAR( pl_p_eql( pl, 6 ), 0.5, 1e-15 );
+  destroy_probability_list( pl );
+
+  CHECK( pl_given_le( d6, 2, &pl ) == GD_OK );
+  CHECK( pl_max( pl ) == 2 );
+  destroy_probability_list( pl );
+
+  destroy_probability_list( d6 );
+}
+
+// Conditional results share the parent's arrays, and are only copied for calculations
+static void test_views() {
+  ProbabilityList *d10 = fair_die( 10 );
+  ProbabilityList *pl = NULL;
+  ProbabilityList *ge = NULL;
+  ProbabilityList *le = NULL;
+  ProbabilityList *inner = NULL;
+  ProbabilityList *copy = NULL;
+  ProbabilityList *q16 = NULL;
+  ProbabilityList *sum = NULL;
+  ProbabilityList *dense = NULL;
+  double p;
+  int t;
+
+  CHECK( pl_repeat_sum( d10, 5, &pl ) == GD_OK );
+  CHECK( pl_given_ge( pl, 30, &ge ) == GD_OK );
+  CHECK( pl_given_le( pl, 20, &le ) == GD_OK );
+  CHECK( ge->storage == PL_STORAGE_VIEW && ge->parent == pl && ge->probs == NULL );
+  CHECK( pl_memsize( ge ) == sizeof(ProbabilityList) );
+  CHECK( pl->refs == 3 );
+  CHECK( pl_min( ge ) == 30 && pl_max( ge ) == 50 );
+  CHECK( pl_min( le ) == 5 && pl_max( le ) == 20 );
+
+  p = pl_p_ge( pl, 30 );
+  for ( t = 28; t <= 52; t++ ) {
+    CHECK_NEAR( pl_p_eql( ge, t ), t >= 30 ? pl_p_eql( pl, t ) / p : 0.0, 1e-15 );
+    CHECK_NEAR( pl_p_gt( ge, t ), t >= 30 ? pl_p_gt( pl, t ) / p : 1.0, 1e-14 );
+    CHECK_NEAR( pl_p_le( ge, t ), t >= 30 ? 1.0 - pl_p_gt( pl, t ) / p : 0.0, 1e-14 );
+  }
+  p = pl_p_le( pl, 20 );
+  for ( t = 4; t <= 22; t++ ) {
+    CHECK_NEAR( pl_p_le( le, t ), t <= 20 ? pl_p_le( pl, t ) / p : 1.0, 1e-14 );
+    CHECK_NEAR( pl_p_ge( le, t ), t <= 20 ? 1.0 - pl_p_lt( pl, t ) / p : 0.0, 1e-14 );
+  }
+  CHECK_NEAR( pl_p_le( ge, 50 ), 1.0, 1e-15 );
+  CHECK_NEAR( pl_p_ge( le, 5 ), 1.0, 1e-15 );
+
+  // Views of views refer to the original distribution
+  CHECK( pl_given_le( ge, 35, &inner ) == GD_OK );
+  CHECK( inner->parent == pl );
+  p = pl_p_ge( pl, 30 ) - pl_p_gt( pl, 35 );
+  CHECK_NEAR( pl_p_eql( inner, 33 ), pl_p_eql( pl, 33 ) / p, 1e-15 );
+  CHECK_NEAR( pl_p_gt( inner, 33 ), ( pl_p_gt( pl, 33 ) - pl_p_gt( pl, 35 ) ) / p, 1e-14 );
+  p = 0.0;
+  for ( t = 30; t <= 35; t++ ) {
+    p += t * pl_p_eql( pl, t ) / ( pl_p_ge( pl, 30 ) - pl_p_gt( pl, 35 ) );
+  }
+  CHECK_NEAR( pl_expected( inner ), p, 1e-12 );
+  // Ranges inside a view come from the end of the distribution nearer the view
+  CHECK( pl->survival != NULL );
+
+  CHECK( copy_probability_list( ge, &copy ) == GD_OK );
+  CHECK( copy->storage == PL_STORAGE_VIEW && pl->refs == 5 );
+
+  // Calculations expand views first
+  CHECK( pl_repeat_sum( ge, 2, &sum ) == GD_OK );
+  CHECK( sum->storage == PL_STORAGE_DOUBLE && ge->powers == NULL );
+  CHECK( ge->dense != NULL && ge->dense->powers != NULL );
+  CHECK( pl_min( sum ) == 60 && pl_max( sum ) == 100 );
+  CHECK( pl_expand( ge, &dense ) == GD_OK );
+  CHECK( dense->storage == PL_STORAGE_DOUBLE );
+  CHECK_NEAR( pl_p_eql( sum, 61 ), 2.0 * pl_p_eql( dense, 30 ) * pl_p_eql( dense, 31 ), 1e-15 );
+  destroy_probability_list( dense );
+  destroy_probability_list( sum );
+
+  // Views outlive the distribution they were made from
+  destroy_probability_list( pl );
+  destroy_probability_list( inner );
+  destroy_probability_list( le );
+  CHECK( ge->parent->refs == 2 );
+  CHECK_NEAR( pl_p_ge( copy, 30 ), 1.0, 1e-15 );
+  destroy_probability_list( ge );
+  CHECK_NEAR( pl_p_gt( copy, 49 ), pl_p_eql( copy, 50 ), 1e-15 );
+  destroy_probability_list( copy );
+
+  // Ranges inside a view of a far tail stay accurate relative to the view
+  CHECK( pl_repeat_sum( d10, 20, &pl ) == GD_OK );
+  CHECK( pl_given_ge( pl, 180, &ge ) == GD_OK );
+  p = 0.0;
+  for ( t = 180; t <= 185; t++ ) p += pl_p_eql( ge, t );
+  CHECK_NEAR( pl_p_le( ge, 185 ) / p, 1.0, 1e-12 );
+  CHECK_NEAR( pl_p_gt( ge, 185 ) / ( 1.0 - p ), 1.0, 1e-12 );
+  destroy_probability_list( ge );
+  destroy_probability_list( pl );
+
+  // Views of compact distributions
+  CHECK( pl_repeat_sum( d10, 3, &pl ) == GD_OK );
+  CHECK( pl_compact( pl, PL_STORAGE_Q16, &q16 ) == GD_OK );
+  CHECK( pl_given_ge( q16, 20, &ge ) == GD_OK );
+  CHECK_NEAR( pl_p_eql( ge, 25 ), pl_p_eql( pl, 25 ) / pl_p_ge( pl, 20 ), 1e-4 );
+  CHECK_NEAR( pl_p_ge( ge, 20 ), 1.0, 1e-12 );
+  destroy_probability_list( q16 );
+  destroy_probability_list( ge );
+  destroy_probability_list( pl );
+
+  destroy_probability_list( d10 );
+}
+
+static void test_stride() {
+  ProbabilityList *d6 = fair_die( 6 );
+  ProbabilityList *d100 = fair_die( 100 );
+  ProbabilityList *tens = NULL;
+  ProbabilityList *pl = NULL;
+  ProbabilityList *given = NULL;
+  double cmp[3];
+
+  // 10 x 1d6 has results 10, 20 .. 60 in 6 slots
+  CHECK( pl_add_distributions_mult( 10, d6, 0, d6, &tens ) == GD_OK );
+  CHECK( tens->stride == 10 );
+  CHECK( tens->slots == 6 );
+  CHECK( pl_min( tens ) == 10 );
+  CHECK( pl_max( tens ) == 60 );
+  CHECK_NEAR( pl_p_eql( tens, 30 ), 1.0 / 6, 1e-15 );
+  CHECK( pl_p_eql( tens, 35 ) == 0.0 );
+  CHECK_NEAR( pl_p_le( tens, 35 ), 0.5, 1e-15 );
+  CHECK_NEAR( pl_p_lt( tens, 30 ), 2.0 / 6, 1e-15 );
+  CHECK_NEAR( pl_p_ge( tens, 31 ), 0.5, 1e-15 );
+  CHECK_NEAR( pl_p_gt( tens, 30 ), 0.5, 1e-15 );
+  CHECK( pl_p_le( tens, 9 ) == 0.0 );
+  CHECK( pl_p_gt( tens, 60 ) == 0.0 );
+  CHECK_NEAR( pl_expected( tens ), 35.0, 1e-12 );
+
+  // Negative multiplier reverses results, stride is kept
+  CHECK( pl_add_distributions_mult( -10, d6, 1, d6, &pl ) == GD_OK );
+  CHECK( pl->stride == 1 );
+  CHECK( pl_min( pl ) == -59 );
+  CHECK_NEAR( pl_p_eql( pl, -59 ), 1.0 / 36, 1e-15 );
+  destroy_probability_list( pl );
+  CHECK( pl_add_distributions_mult( -10, d6, 0, d6, &pl ) == GD_OK );
+  CHECK( pl->stride == 10 && pl_min( pl ) == -60 );
+  CHECK( pl_p_le( pl, -31 ) > 0.49 && pl_p_le( pl, -31 ) < 0.51 );
+  destroy_probability_list( pl );
+
+  // Sums and repeats keep a shared stride
+  CHECK( pl_repeat_sum( tens, 3, &pl ) == GD_OK );
+  CHECK( pl->stride == 10 && pl->slots == 16 );
+  CHECK_NEAR( pl_p_eql( pl, 30 ), 1.0 / 216, 1e-15 );
+  destroy_probability_list( pl );
+
+  CHECK( pl_repeat_n_sum_k( tens, 4, 3, 1, &pl ) == GD_OK );
+  CHECK( pl->stride == 10 );
+  CHECK_NEAR( pl_p_eql( pl, 180 ), 21.0 / 1296, 1e-15 );
+  CHECK_NEAR( pl_expected( pl ), 158690.0 / 1296, 1e-9 );
+  destroy_probability_list( pl );
+
+  // 10 x 1d6 + 1d100 is dense again
+  CHECK( pl_add_distributions( tens, d100, &pl ) == GD_OK );
+  CHECK( pl->stride == 1 );
+  CHECK( pl_min( pl ) == 11 && pl_max( pl ) == 160 );
+  CHECK_NEAR( pl_p_eql( pl, 11 ), 1.0 / 600, 1e-15 );
+  CHECK_NEAR( pl_p_eql( pl, 60 ), 5.0 / 600, 1e-15 );
+  CHECK_NEAR( pl_expected( pl ), 85.5, 1e-9 );
+  destroy_probability_list( pl );
+
+  CHECK( pl_given_ge( tens, 25, &given ) == GD_OK );
+  CHECK( pl_min( given ) == 30 && given->stride == 10 );
+  CHECK_NEAR( pl_p_eql( given, 30 ), 0.25, 1e-15 );
+  destroy_probability_list( given );
+  CHECK( pl_given_le( tens, 25, &given ) == GD_OK );
+  CHECK( pl_max( given ) == 20 && given->stride == 10 );
+  destroy_probability_list( given );
+
+  pl_compare( tens, d6, cmp );
+  CHECK_NEAR( cmp[0], 1.0, 1e-15 );
+  pl_compare( d100, tens, cmp );
+  CHECK_NEAR( cmp[1], 6.0 / 600, 1e-15 );
+
+  destroy_probability_list( tens );
+  destroy_probability_list( d100 );
+  destroy_probability_list( d6 );
+}
+
+static void test_hash() {
+  ProbabilityList *d6 = fair_die( 6 );
+  ProbabilityList *other_d6 = fair_die( 6 );
+  ProbabilityList *d8 = fair_die( 8 );
+  ProbabilityList *zero_d6 = NULL;
+  ProbabilityList *pl = NULL;
+  ProbabilityList *ge = NULL;
+  ProbabilityList *dense = NULL;
+  ProbabilityList *f32 = NULL;
+  ProbabilityList *one = NULL;
+  ProbabilityList *other_one = NULL;
+  ProbabilityList *padded = NULL;
+  ProbabilityList *strided = NULL;
+
+  CHECK( pl_equal( d6, other_d6 ) && pl_hash( d6 ) == pl_hash( other_d6 ) );
+  CHECK( ! pl_equal( d6, d8 ) && pl_hash( d6 ) != pl_hash( d8 ) );
+  CHECK( new_basic_pl( 6, 1.0 / 6, 0, &zero_d6 ) == GD_OK );
+  CHECK( ! pl_equal( d6, zero_d6 ) && pl_hash( d6 ) != pl_hash( zero_d6 ) );
+
+  // Content is compared as read back, whatever the storage
+  CHECK( pl_repeat_sum( d6, 4, &pl ) == GD_OK );
+  CHECK( pl_given_ge( pl, 12, &ge ) == GD_OK );
+  CHECK( pl_expand( ge, &dense ) == GD_OK );
+  CHECK( pl_equal( ge, dense ) && pl_hash( ge ) == pl_hash( dense ) );
+  CHECK( pl_compact( pl, PL_STORAGE_FLOAT32, &f32 ) == GD_OK );
+  CHECK( ! pl_equal( pl, f32 ) );
+
+  // Stride does not matter for a single result
+  CHECK( new_basic_pl( 1, 1.0, 5, &one ) == GD_OK );
+  CHECK( new_basic_pl( 1, 1.0, 5, &other_one ) == GD_OK );
+  other_one->stride = 3;
+  CHECK( pl_equal( one, other_one ) && pl_hash( one ) == pl_hash( other_one ) );
+
+  // Nor do stride and zero slots, only results with non-zero probabilities
+  CHECK( new_basic_pl( 3, 0.5, 0, &padded ) == GD_OK );
+  padded->probs[1] = 0.0;
+  calc_cumulative( padded );
+  CHECK( new_basic_pl( 2, 0.5, 0, &strided ) == GD_OK );
+  strided->stride = 2;
+  CHECK( pl_equal( padded, strided ) && pl_hash( padded ) == pl_hash( strided ) );
+  strided->offset = 1;
+  CHECK( ! pl_equal( padded, strided ) && pl_hash( padded ) != pl_hash( strided ) );
+  destroy_probability_list( strided );
+  destroy_probability_list( padded );
+
+  destroy_probability_list( other_one );
+  destroy_probability_list( one );
+  destroy_probability_list( f32 );
+  destroy_probability_list( dense );
+  destroy_probability_list( ge );
+  destroy_probability_list( pl );
+  destroy_probability_list( zero_d6 );
+  destroy_probability_list( d8 );
+  destroy_probability_list( other_d6 );
+  destroy_probability_list( d6 );
+}
+
+static void test_compact() {
+  ProbabilityList *d10 = fair_die( 10 );
+  ProbabilityList *pl = NULL;
+  ProbabilityList *f32 = NULL;
+  ProbabilityList *q16 = NULL;
+  ProbabilityList *sum = NULL;
+  ProbabilityList *back = NULL;
+  ProbabilityList *view = NULL;
+  double cmp[3], dense_cmp[3];
+  int t;
+
+  CHECK( pl_repeat_sum( d10, 10, &pl ) == GD_OK );
+  CHECK( pl_compact( pl, PL_STORAGE_FLOAT32, &f32 ) == GD_OK );
+  CHECK( pl_compact( pl, PL_STORAGE_Q16, &q16 ) == GD_OK );
+  CHECK( f32->probs == NULL && f32->cumulative == NULL );
+  CHECK( ( pl_memsize( f32 ) - sizeof(ProbabilityList) ) * 4 == pl_memsize( pl ) - sizeof(ProbabilityList) );
+  CHECK( ( pl_memsize( q16 ) - sizeof(ProbabilityList) ) * 8 == pl_memsize( pl ) - sizeof(ProbabilityList) );
+
+  // Documented error bounds
+  for ( t = 10; t <= 100; t++ ) {
+    CHECK( fabs( pl_p_eql( f32, t ) - pl_p_eql( pl, t ) ) <= pl_p_eql( pl, t ) * 6e-8 );
+    CHECK( fabs( pl_p_ge( f32, t ) - pl_p_ge( pl, t ) ) <= pl_p_ge( pl, t ) * 6e-8 );
+    CHECK( fabs( pl_p_le( f32, t ) - pl_p_le( pl, t ) ) <= pl_p_le( pl, t ) * 6e-8 );
+    CHECK( fabs( pl_p_eql( q16, t ) - pl_p_eql( pl, t ) ) <= pl_p_eql( pl, 55 ) / 131070 );
+  }
+  CHECK( pl_p_ge( q16, 10 ) == 1.0 );
+  CHECK( pl_p_gt( q16, 100 ) == 0.0 );
+  CHECK_NEAR( pl_expected( f32 ), 55.0, 1e-6 );
+
+  // Calculations run in double precision on a temporary copy
+  CHECK( pl_add_distributions( f32, d10, &sum ) == GD_OK );
+  CHECK( sum->storage == PL_STORAGE_DOUBLE );
+  CHECK( pl_max( sum ) == 110 );
+  destroy_probability_list( sum );
+  CHECK( pl_repeat_sum( q16, 2, &sum ) == GD_OK );
+  CHECK( pl_max( sum ) == 200 );
+  CHECK( q16->powers == NULL && q16->dense != NULL && q16->dense->powers != NULL );
+  destroy_probability_list( sum );
+  CHECK( pl_repeat_n_sum_k( f32, 3, 2, 1, &sum ) == GD_OK );
+  CHECK( pl_max( sum ) == 200 );
+  destroy_probability_list( sum );
+  pl_compare( f32, q16, cmp );
+  CHECK_NEAR( cmp[0], cmp[2], 1e-4 );
+
+  // Compact and view opponents are read directly, and give the same answers as dense copies
+  CHECK( pl_given_ge( pl, 40, &view ) == GD_OK );
+  CHECK( pl_expand( view, &back ) == GD_OK );
+  pl_compare( f32, view, cmp );
+  pl_compare( f32, back, dense_cmp );
+  CHECK( cmp[0] == dense_cmp[0] && cmp[1] == dense_cmp[1] && cmp[2] == dense_cmp[2] );
+  CHECK_NEAR( cmp[0] + cmp[1] + cmp[2], 1.0, 1e-6 );
+  destroy_probability_list( back );
+  CHECK( pl_expand( q16, &back ) == GD_OK );
+  pl_compare( view, q16, cmp );
+  pl_compare( view, back, dense_cmp );
+  CHECK( cmp[0] == dense_cmp[0] && cmp[1] == dense_cmp[1] && cmp[2] == dense_cmp[2] );
+  destroy_probability_list( back );
+  destroy_probability_list( view );
+
+  CHECK( pl_expand( f32, &back ) == GD_OK );
+  CHECK( back->storage == PL_STORAGE_DOUBLE );
+  CHECK_NEAR( pl_p_le( back, 55 ), pl_p_le( pl, 55 ), 1e-7 );
+  destroy_probability_list( back );
+  CHECK( pl_compact( pl, 7, &back ) == GD_ERR_BAD_STORAGE );
+
+  destroy_probability_list( q16 );
+  destroy_probability_list( f32 );
+  destroy_probability_list( pl );
+  destroy_probability_list( d10 );
+}
+
+// Smallest budget, so that results of a few thousand slots need several blocks
+static void test_mapped() {
+  ProbabilityList *d100 = fair_die( 100 );
+  ProbabilityList *tens = NULL;
+  ProbabilityList *pl = NULL;
+  ProbabilityList *back = NULL;
+  MappedProbabilityList *m100 = NULL;
+  MappedProbabilityList *msum = NULL;
+  MappedProbabilityList *mtens = NULL;
+  MappedProbabilityList *opened = NULL;
+  MappedProbabilityList *replaced = NULL;
+  const char *path = "test_mapped.gdprob";
+  volatile int cancel = 1;
+  mode_t old_mask = umask( 027 );
+  struct stat st;
+  double p, q;
+  int t;
+
+  CHECK( mpl_for_fair_die( 100, NULL, MPL_MIN_BUDGET, &m100 ) == GD_OK );
+  CHECK( mpl_repeat_sum( m100, 37, path, MPL_MIN_BUDGET, NULL, &msum ) == GD_OK );
+  // New files follow the umask
+  CHECK( stat( path, &st ) == 0 && ( st.st_mode & 0777 ) == 0640 );
+  CHECK( pl_repeat_sum( d100, 37, &pl ) == GD_OK );
+  CHECK( mpl_min( msum ) == 37 && mpl_max( msum ) == 3700 );
+  for ( t = 30; t <= 3710; t += 67 ) {
+    CHECK( mpl_p_eql( msum, t, &p ) == GD_OK );
+    CHECK( fabs( p - pl_p_eql( pl, t ) ) <= 1e-12 * pl_p_eql( pl, t ) + 1e-300 );
+    CHECK( mpl_p_le( msum, t, MPL_MIN_BUDGET, &p ) == GD_OK );
+    CHECK( fabs( p - pl_p_le( pl, t ) ) <= 1e-12 );
+    CHECK( mpl_p_gt( msum, t, MPL_MIN_BUDGET, &p ) == GD_OK );
+    CHECK( fabs( p - pl_p_gt( pl, t ) ) <= 1e-12 * pl_p_gt( pl, t ) + 1e-300 );
+  }
+  CHECK( mpl_expected( msum, MPL_MIN_BUDGET, &p ) == GD_OK );
+  CHECK_NEAR( p, 37 * 50.5, 1e-8 );
+
+  // File can be reopened and converted back
+  CHECK( mpl_open( path, &opened ) == GD_OK );
+  CHECK( opened->slots == 3664 );
+  CHECK( mpl_to_probability_list( opened, &back ) == GD_OK );
+  CHECK_NEAR( pl_p_le( back, 1800 ), pl_p_le( pl, 1800 ), 1e-12 );
+  destroy_probability_list( back );
+  destroy_mapped_probability_list( opened );
+  remove( path );
+
+  // A result may replace one of its inputs, which reads as before until the result is complete
+  CHECK( mpl_from_probability_list( d100, path, &opened ) == GD_OK );
+  chmod( path, 0600 );
+  CHECK( mpl_add_distributions( opened, m100, path, MPL_MIN_BUDGET, NULL, &replaced ) == GD_OK );
+  // and replaced files keep their permissions
+  CHECK( stat( path, &st ) == 0 && ( st.st_mode & 0777 ) == 0600 );
+  CHECK( mpl_p_eql( replaced, 101, &p ) == GD_OK );
+  CHECK_NEAR( p, 0.01, 1e-15 );
+  CHECK( mpl_expected( replaced, MPL_MIN_BUDGET, &p ) == GD_OK );
+  CHECK_NEAR( p, 101.0, 1e-10 );
+  destroy_mapped_probability_list( replaced );
+  destroy_mapped_probability_list( opened );
+
+  // A cancelled calculation stops, and leaves the file at path as it was
+  CHECK( mpl_repeat_sum( m100, 50, path, MPL_MIN_BUDGET, &cancel, &replaced ) == GD_ERR_INTERRUPTED );
+  CHECK( mpl_open( path, &opened ) == GD_OK );
+  CHECK( opened->slots == 199 );
+  destroy_mapped_probability_list( opened );
+  remove( path );
+
+  // Strides are kept, and mixed strides combine
+  CHECK( pl_add_distributions_mult( 10, d100, 0, d100, &tens ) == GD_OK );
+  CHECK( mpl_from_probability_list( tens, NULL, &mtens ) == GD_OK );
+  destroy_mapped_probability_list( msum );
+  CHECK( mpl_add_distributions( mtens, m100, NULL, MPL_MIN_BUDGET, NULL, &msum ) == GD_OK );
+  destroy_probability_list( pl );
+  CHECK( pl_add_distributions( tens, d100, &pl ) == GD_OK );
+  CHECK( msum->stride == 1 && mpl_max( msum ) == 1100 );
+  for ( t = 11; t <= 1100; t += 13 ) {
+    CHECK( mpl_p_eql( msum, t, &p ) == GD_OK );
+    CHECK_NEAR( p, pl_p_eql( pl, t ), 1e-15 );
+  }
+  destroy_mapped_probability_list( msum );
+  CHECK( mpl_repeat_sum( mtens, 3, NULL, MPL_MIN_BUDGET, NULL, &msum ) == GD_OK );
+  CHECK( msum->stride == 10 && msum->slots == 298 );
+  CHECK( mpl_p_eql( msum, 35, &p ) == GD_OK && p == 0.0 );
+  CHECK( mpl_p_le( msum, 1505, MPL_MIN_BUDGET, &p ) == GD_OK );
+  CHECK( mpl_p_gt( msum, 1505, MPL_MIN_BUDGET, &q ) == GD_OK );
+  CHECK_NEAR( p + q, 1.0, 1e-12 );
+
+  CHECK( mpl_repeat_sum( m100, 0, NULL, MPL_MIN_BUDGET, NULL, &opened ) == GD_ERR_N_TOO_SMALL );
+  CHECK( mpl_repeat_sum( m100, 1LL << 33, NULL, MPL_MIN_BUDGET, NULL, &opened ) == GD_ERR_TOO_MANY_SLOTS );
+  CHECK( mpl_open( "no/such/file", &opened ) == GD_ERR_IO );
+  CHECK( mpl_open( "Makefile", &opened ) == GD_ERR_BAD_FILE );
+
+  destroy_mapped_probability_list( msum );
+  destroy_mapped_probability_list( mtens );
+  destroy_mapped_probability_list( m100 );
+  destroy_probability_list( tens );
+  destroy_probability_list( pl );
+  destroy_probability_list( d100 );
+  umask( old_mask );
+}
+
+static void test_errors() {
+  ProbabilityList *d6 = fair_die( 6 );
+  ProbabilityList *d1000 = fair_die( 1000 );
+  ProbabilityList *pl = NULL;
+
+  CHECK( new_basic_pl( 0, 1.0, 0, &pl ) == GD_ERR_BAD_SLOTS );
+  CHECK( new_basic_pl( PL_MAX_SLOTS + 1, 0.0, 0, &pl ) == GD_ERR_BAD_SLOTS );
+  CHECK( new_basic_pl( 2, 1.5, 0, &pl ) == GD_ERR_BAD_PROBABILITY );
+  CHECK( pl_repeat_sum( d6, 0, &pl ) == GD_ERR_N_TOO_SMALL );
+  CHECK( pl_repeat_sum( d1000, 11000, &pl ) == GD_ERR_TOO_MANY_SLOTS );
+  CHECK( pl_repeat_n_sum_k( d6, 5, 0, 1, &pl ) == GD_ERR_K_TOO_SMALL );
+  CHECK( pl_repeat_n_sum_k( d6, 171, 10, 1, &pl ) == GD_ERR_TOO_MANY_DICE );
+  CHECK( pl_given_ge( d6, 7, &pl ) == GD_ERR_DIVIDE_BY_ZERO );
+  CHECK( pl_given_le( d6, 0, &pl ) == GD_ERR_DIVIDE_BY_ZERO );
+  CHECK( pl == NULL );
+
+  destroy_probability_list( d6 );
+  destroy_probability_list( d1000 );
+}
+
+int main() {
+  test_basic_queries();
+  test_add_distributions();
+  test_repeat_sum();
+  test_fair_dice();
+  test_repeat_n_sum_k();
+  test_given();
+  test_stride();
+  test_views();
+  test_hash();
+  test_compact();
+  test_mapped();
+  test_errors();
+
+  printf( "%d checks, %d failures\n", checks, failures );
+  return failures ? 1 : 0;
+}
@@ -4,4 +4,15 @@
 
 require 'mkmf'
 
+# The distribution kernels live in core/, which has no Ruby dependencies and can also be built
+# as a standalone static library (see core/Makefile). The gem compiles the same sources directly
+# into the extension, but not the native test and benchmark programs.
+$VPATH << '$(srcdir)/core'
+$INCFLAGS << ' -I$(srcdir)/core'
+$srcs = Dir.glob(File.join(__dir__, '*.c')) +
+        Dir.glob(File.join(__dir__, 'core', '*.c')).reject { |f| File.basename(f) =~ /\A(test|bench)_/ }
+
+# Compaction support for objects that hold references to other Ruby objects (Ruby 2.7+)
+have_func('rb_gc_mark_movable')
+
 create_makefile('games_dice/games_dice')
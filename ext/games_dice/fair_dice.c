@@ -0,0 +1,461 @@
+// ext/games_dice/fair_dice.c
+
+#include "fair_dice.h"
+#include <math.h>
+#include <float.h>
+
+// Estimated relative error that we accept from a closed-form calculation, before trying another
+#define FD_TOLERANCE 1.0e-12
+
+#define FD_PI 3.141592653589793238462643383279502884L
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Point queries on the sum of n fair s-sided dice, without building the distribution.
+//
+//  All calculations work on S' = S - n, which takes values 0..d where d = n * ( s - 1 ). The
+//  distribution is symmetric, so a query is always turned into one on the lower half, where
+//  the inclusion-exclusion sums are shortest.
+//
+
+static inline long double log_choose( long double a, long double b ) {
+  return lgammal( a + 1.0L ) - lgammal( b + 1.0L ) - lgammal( a - b + 1.0L );
+}
+
+// Exact formula, with terms summed in log space:
+//   P( S' == u ) = sum_k (-1)^k C(n,k) C(u - ks + n - 1, n - 1) / s^n
+//   P( S' <= u ) = sum_k (-1)^k C(n,k) C(u - ks + n, n) / s^n
+// This is accurate in the tails, where there are few terms, but the alternating sum loses
+// precision towards the middle of the distribution. Only the first term is calculated via
+// lgamma, and the rest from ratios between terms, so that any error in the first term is shared
+// by all of them, and does not get amplified by cancellation.
+static double fd_incl_excl( int n, int s, long u, int cumulative, double *rel_err ) {
+  long k, a;
+  int i;
+  long kmax = u / s;
+  int r = cumulative ? n : n - 1;
+  long double l_0, l, t, sum = 0.0L, comp = 0.0L, abs_sum = 0.0L, l_err;
+
+  if ( kmax > n ) {
+    kmax = n;
+  }
+
+  l_0 = log_choose( u + r, r ) - n * logl( (long double) s );
+  l = 0.0L;
+  a = u + r;
+  for ( k = 0; k <= kmax; k++ ) {
+    if ( k > 0 ) {
+      // C(n,k) / C(n,k-1) and C(a - s, r) / C(a, r)
+      l += logl( (long double) ( n - k + 1 ) / k );
+      for ( i = 0; i < s; i++ ) {
+        l += log1pl( - (long double) r / ( a - i ) );
+      }
+      a -= s;
+    }
+    t = expl( l );
+    abs_sum += t;
+    if ( k & 1 ) t = -t;
+    // Neumaier summation
+    if ( fabsl( sum ) >= fabsl( t ) ) {
+      comp += ( sum - ( sum + t ) ) + t;
+    } else {
+      comp += ( t - ( sum + t ) ) + sum;
+    }
+    sum += t;
+  }
+  sum += comp;
+
+  if ( sum <= 0.0L ) {
+    *rel_err = INFINITY;
+    return 0.0;
+  }
+
+  l_err = 8.0L * LDBL_EPSILON * ( lgammal( u + r + 1.0L ) + n * logl( (long double) s ) );
+  *rel_err = (double) ( l_err + ( abs_sum / sum ) * 4.0L * ( kmax * ( s + 1 ) + 1 ) * LDBL_EPSILON ) + DBL_EPSILON;
+
+  return (double) ( sum * expl( l_0 ) );
+}
+
+// Inverse discrete Fourier transform of the characteristic function, evaluated one frequency
+// at a time, so memory use is constant. The transform of one die is real after removing its
+// mean, and has magnitude rho_j = sin( pi j s / m ) / ( s sin( pi j / m ) ), so:
+//   P( S' == u ) = 1/m sum_j rho_j^n cos( pi j ( d - 2u ) / m )
+//   P( S' <= u ) = 1/m sum_j rho_j^n cos( pi j ( d - u ) / m ) sin( pi j ( u + 1 ) / m ) / sin( pi j / m )
+// Terms j and m - j are equal, and rho_j^n vanishes quickly, so usually only a few terms near
+// j = 0 are needed. Errors are absolute, so this is accurate near the middle of the distribution.
+static double fd_fourier( int n, int s, long u, int cumulative, double *rel_err ) {
+  long long m = (long long) n * ( s - 1 ) + 1;
+  long long d = m - 1;
+  long long two_m = 2 * m;
+  long long j;
+  long double pi_m = FD_PI / m;
+  long double log_m2 = 2.0L * logl( (long double) m );
+  long double sum, abs_sum, sin_j, rho, lim, term, result, abs_err;
+  int weight;
+
+  sum = cumulative ? u + 1.0L : 1.0L;
+  abs_sum = sum;
+  abs_err = 0.0L;
+
+  for ( j = 1; 2 * j <= m; j++ ) {
+    sin_j = sinl( pi_m * j );
+    rho = sinl( pi_m * ( ( j * s ) % two_m ) ) / ( s * sin_j );
+
+    // Within the main lobe, rho_j is decreasing. Beyond it, |rho_j| is bounded by 1 / ( s sin_j )
+    // which is at most 0.5, so we can stop once all remaining terms are negligible.
+    if ( j * s < m ) {
+      lim = fabsl( rho ) > 0.5L ? fabsl( rho ) : 0.5L;
+    } else {
+      lim = 1.0L / ( s * sin_j );
+      if ( lim > 1.0L ) lim = 1.0L;
+    }
+    if ( n * logl( lim ) + log_m2 < -46.0L ) {
+      abs_err += 1.0e-20L;
+      break;
+    }
+
+    term = powl( rho, n );
+    if ( cumulative ) {
+      term *= cosl( pi_m * ( ( j * ( d - u ) ) % two_m ) ) * sinl( pi_m * ( ( j * ( u + 1 ) ) % two_m ) ) / sin_j;
+    } else {
+      term *= cosl( pi_m * ( ( j * llabs( d - 2 * u ) ) % two_m ) );
+    }
+
+    weight = ( 2 * j == m ) ? 1 : 2;
+    sum += weight * term;
+    abs_sum += weight * fabsl( term );
+  }
+
+  result = sum / m;
+  abs_err += ( abs_sum / m ) * ( n + 16 ) * LDBL_EPSILON;
+  if ( result <= 0.0L ) {
+    *rel_err = INFINITY;
+    return 0.0;
+  }
+  *rel_err = (double) ( abs_err / result );
+  return (double) result;
+}
+
+// Complex expm1, accurate when z is close to 0
+static inline void cexpm1l( long double x, long double y, long double *re, long double *im ) {
+  long double sh = sinl( 0.5L * y );
+  *re = expm1l( x ) * cosl( y ) - 2.0L * sh * sh;
+  *im = expl( x ) * sinl( y );
+}
+
+// Mean of a single die, numbered 0..s-1, after tilting by e^(lambda i)
+static long double tilted_mean( int s, long double lambda ) {
+  if ( fabsl( lambda ) < 1.0e-9L ) {
+    return 0.5L * ( s - 1 ) + lambda * ( (long double) s * s - 1.0L ) / 12.0L;
+  }
+  return 1.0L / expm1l( -lambda ) - s / expm1l( -lambda * s );
+}
+
+// The same transform as fd_fourier, but applied to an exponentially tilted distribution, where
+// the target u is the mean. The result is scaled back by the (Chernoff) factor
+//   M(lambda)^n e^(-lambda u)
+// Relative errors are then small even far into the tails, where the plain transform is useless.
+// The cost is that terms decay more slowly, so more of them are needed.
+static double fd_tilted_fourier( int n, int s, long u, int cumulative, double *rel_err ) {
+  long long m = (long long) n * ( s - 1 ) + 1;
+  long long j;
+  long double lambda, lo = -700.0L, hi = 0.0L, target = (long double) u / n;
+  long double g_re, g_im, e_re, e_im, h_re, h_im, d, g_lambda, log_scale;
+  long double mag, phase, c_re, c_im, y_mag, y_phase, q_re, q_im, t_re, t_im;
+  long double sum, abs_sum, abs_err, bound, log_bound_extra, result;
+  long double two_pi_m = 2.0L * FD_PI / m;
+  int i, weight;
+
+  // Saddle point, by bisection. Any lambda gives an exact formula, so this need not be precise.
+  for ( i = 0; i < 100; i++ ) {
+    lambda = 0.5L * ( lo + hi );
+    if ( tilted_mean( s, lambda ) > target ) {
+      hi = lambda;
+    } else {
+      lo = lambda;
+    }
+  }
+  lambda = 0.5L * ( lo + hi );
+  if ( lambda > -1.0e-6L ) {
+    *rel_err = INFINITY;
+    return 0.0;
+  }
+
+  // G(lambda) = sum_i e^(lambda i) = expm1( lambda s ) / expm1( lambda )
+  g_lambda = expm1l( lambda * s ) / expm1l( lambda );
+  log_scale = n * logl( g_lambda / s ) - lambda * u;
+
+  sum = 0.0L;
+  abs_sum = 0.0L;
+  abs_err = 0.0L;
+  // Sum of geometric series in e^lambda is at most this much
+  log_bound_extra = logl( (long double) m ) + ( cumulative ? logl( 2.0L / -expm1l( lambda ) ) : 0.0L );
+
+  for ( j = 0; 2 * j <= m; j++ ) {
+    // e = expm1( lambda + i theta ), g = expm1( s ( lambda + i theta ) )
+    cexpm1l( lambda, two_pi_m * j, &e_re, &e_im );
+    if ( j > 0 ) {
+      // |phi| is no more than ( 1 + e^(lambda s) ) / ( |e^(lambda + i theta) - 1| G(lambda) ), which
+      // decreases with theta, so once it is small enough, so are all remaining terms
+      bound = ( 1.0L + expl( lambda * s ) ) / ( sqrtl( e_re * e_re + e_im * e_im ) * g_lambda );
+      if ( bound < 1.0L && n * logl( bound ) + log_bound_extra < -46.0L ) {
+        abs_err += 1.0e-20L;
+        break;
+      }
+    }
+    cexpm1l( lambda * s, two_pi_m * ( ( j * s ) % m ), &g_re, &g_im );
+
+    // phi = g / ( e G(lambda) )
+    d = ( e_re * e_re + e_im * e_im ) * g_lambda;
+    h_re = ( g_re * e_re + g_im * e_im ) / d;
+    h_im = ( g_im * e_re - g_re * e_im ) / d;
+    if ( j == 0 ) {
+      h_re = 1.0L;
+      h_im = 0.0L;
+    }
+
+    // phi^n e^( -i theta u )
+    mag = expl( n * 0.5L * logl( h_re * h_re + h_im * h_im ) );
+    phase = n * atan2l( h_im, h_re ) - two_pi_m * ( ( j * u ) % m );
+    c_re = mag * cosl( phase );
+    c_im = mag * sinl( phase );
+
+    if ( cumulative ) {
+      // times ( 1 - y^(u+1) ) / ( 1 - y ), y = e^( lambda + i theta )
+      y_mag = expl( lambda * ( u + 1 ) );
+      y_phase = two_pi_m * ( ( j * ( u + 1 ) ) % m );
+      q_re = 1.0L - y_mag * cosl( y_phase );
+      q_im = - y_mag * sinl( y_phase );
+      d = e_re * e_re + e_im * e_im;
+      // divide by ( 1 - y ) = -e
+      t_re = - ( q_re * e_re + q_im * e_im ) / d;
+      t_im = - ( q_im * e_re - q_re * e_im ) / d;
+      q_re = c_re * t_re - c_im * t_im;
+      c_im = c_re * t_im + c_im * t_re;
+      c_re = q_re;
+    }
+
+    weight = ( j == 0 || 2 * j == m ) ? 1 : 2;
+    sum += weight * c_re;
+    abs_sum += weight * sqrtl( c_re * c_re + c_im * c_im );
+  }
+
+  abs_err += abs_sum * ( n + 16 ) * LDBL_EPSILON;
+  if ( sum <= 0.0L ) {
+    *rel_err = INFINITY;
+    return 0.0;
+  }
+  *rel_err = (double) ( abs_err / sum + ( fabsl( log_scale ) + 16 ) * LDBL_EPSILON );
+  result = expl( log_scale ) * sum / m;
+  return (double) result;
+}
+
+// Last resort, build the whole distribution
+static double fd_convolution( int n, int s, long u, int cumulative ) {
+  ProbabilityList *pl_sum;
+  double p;
+
+  if ( (long long) n * ( s - 1 ) >= 1000000 ) {
+    rb_raise( rb_eRuntimeError, "Too many probability slots to calculate fair dice probability accurately" );
+  }
+
+  check_pl_error( pl_fair_dice( n, s, &pl_sum ) );
+  p = cumulative ? pl_p_le( pl_sum, u + n ) : pl_p_eql( pl_sum, u + n );
+  destroy_probability_list( pl_sum );
+  return p;
+}
+
+// Tries each method in order of cost, until one claims to be accurate enough
+static double fd_lower( int n, int s, long u, int cumulative ) {
+  double err, p;
+
+  if ( u / s <= 64 ) {
+    p = fd_incl_excl( n, s, u, cumulative, &err );
+    if ( err < FD_TOLERANCE ) {
+      return p;
+    }
+  }
+  p = fd_fourier( n, s, u, cumulative, &err );
+  if ( err < FD_TOLERANCE ) {
+    return p;
+  }
+  p = fd_tilted_fourier( n, s, u, cumulative, &err );
+  if ( err < FD_TOLERANCE ) {
+    return p;
+  }
+  return fd_convolution( n, s, u, cumulative );
+}
+
+double fd_p_eql( int n, int s, long target ) {
+  long d = (long) n * ( s - 1 );
+  long u = target - n;
+  if ( u < 0 || u > d ) {
+    return 0.0;
+  }
+  if ( 2 * u > d ) {
+    u = d - u;
+  }
+  return fd_lower( n, s, u, 0 );
+}
+
+double fd_p_le( int n, int s, long target ) {
+  long d = (long) n * ( s - 1 );
+  long u = target - n;
+  if ( u < 0 ) {
+    return 0.0;
+  }
+  if ( u >= d ) {
+    return 1.0;
+  }
+  if ( 2 * u > d ) {
+    return 1.0 - fd_lower( n, s, d - u - 1, 1 );
+  }
+  return fd_lower( n, s, u, 1 );
+}
+
+double fd_p_ge( int n, int s, long target ) {
+  // By symmetry, P( S >= t ) == P( S <= n * ( s + 1 ) - t )
+  return fd_p_le( n, s, (long) n * ( s + 1 ) - target );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Ruby integration
+//
+
+#define FD_EQL 0
+#define FD_LE  1
+#define FD_GE  2
+
+static inline long floor_div( long a, long b ) {
+  long q = a / b;
+  if ( ( a % b != 0 ) && ( ( a < 0 ) != ( b < 0 ) ) ) q--;
+  return q;
+}
+
+static inline long ceil_div( long a, long b ) {
+  return -floor_div( -a, b );
+}
+
+// Converts a query on total = multiplier * sum into the matching query on sum
+VALUE fair_dice_query( int argc, VALUE* argv, int query, long adjust ) {
+  VALUE ndice, sides, target, multiplier;
+  int n, s;
+  long m, t;
+
+  rb_scan_args( argc, argv, "31", &ndice, &sides, &target, &multiplier );
+  n = NUM2INT( ndice );
+  s = NUM2INT( sides );
+  t = NUM2LONG( target ) + adjust;
+  m = NIL_P(multiplier) ? 1 : NUM2LONG( multiplier );
+
+  if ( n < 1 ) {
+    rb_raise( rb_eArgError, "Number of dice should be 1 or more" );
+  }
+  if ( s < 1 ) {
+    rb_raise( rb_eArgError, "Number of sides should be 1 or more" );
+  }
+  if ( (long long) n * ( s - 1 ) >= 0x7fffffff ) {
+    rb_raise( rb_eArgError, "Too many possible results" );
+  }
+  if ( m == 0 ) {
+    rb_raise( rb_eArgError, "Multiplier should not be 0" );
+  }
+
+  switch ( query ) {
+    case FD_EQL:
+      if ( t % m != 0 ) {
+        return DBL2NUM( 0.0 );
+      }
+      return DBL2NUM( fd_p_eql( n, s, t / m ) );
+    case FD_LE:
+      return DBL2NUM( m > 0 ? fd_p_le( n, s, floor_div( t, m ) ) : fd_p_ge( n, s, ceil_div( t, m ) ) );
+    default:
+      return DBL2NUM( m > 0 ? fd_p_ge( n, s, ceil_div( t, m ) ) : fd_p_le( n, s, floor_div( t, m ) ) );
+  }
+}
+
+/*
+ * @overload fair_dice_p_eql(ndice, sides, target, multiplier = 1)
+ *   Probability that the total of a number of fair dice, times a multiplier, equals a specific
+ *   target. The full distribution is not calculated unless that is needed for accuracy, so this
+ *   is much cheaper than GamesDice::Probabilities#p_eql for one-off queries on large pools.
+ *   @param [Integer] ndice Number of dice
+ *   @param [Integer] sides Number of sides on each die
+ *   @param [Integer] target
+ *   @param [Integer] multiplier Applied to sum of dice, e.g. -1 when the dice are subtracted
+ *   @return [Float] in range (0.0..1.0)
+ */
+VALUE probabilities_fair_dice_p_eql( int argc, VALUE* argv, VALUE self ) {
+  return fair_dice_query( argc, argv, FD_EQL, 0 );
+}
+
+/*
+ * @overload fair_dice_p_le(ndice, sides, target, multiplier = 1)
+ *   Probability that the total of a number of fair dice, times a multiplier, is less than or
+ *   equal to a specific target. See #fair_dice_p_eql.
+ *   @param [Integer] ndice Number of dice
+ *   @param [Integer] sides Number of sides on each die
+ *   @param [Integer] target
+ *   @param [Integer] multiplier Applied to sum of dice, e.g. -1 when the dice are subtracted
+ *   @return [Float] in range (0.0..1.0)
+ */
+VALUE probabilities_fair_dice_p_le( int argc, VALUE* argv, VALUE self ) {
+  return fair_dice_query( argc, argv, FD_LE, 0 );
+}
+
+/*
+ * @overload fair_dice_p_lt(ndice, sides, target, multiplier = 1)
+ *   Probability that the total of a number of fair dice, times a multiplier, is less than a
+ *   specific target. See #fair_dice_p_eql.
+ *   @param [Integer] ndice Number of dice
+ *   @param [Integer] sides Number of sides on each die
+ *   @param [Integer] target
+ *   @param [Integer] multiplier Applied to sum of dice, e.g. -1 when the dice are subtracted
+ *   @return [Float] in range (0.0..1.0)
+ */
+VALUE probabilities_fair_dice_p_lt( int argc, VALUE* argv, VALUE self ) {
+  return fair_dice_query( argc, argv, FD_LE, -1 );
+}
+
+/*
+ * @overload fair_dice_p_ge(ndice, sides, target, multiplier = 1)
+ *   Probability that the total of a number of fair dice, times a multiplier, is greater than or
+ *   equal to a specific target. See #fair_dice_p_eql.
+ *   @param [Integer] ndice Number of dice
+ *   @param [Integer] sides Number of sides on each die
+ *   @param [Integer] target
+ *   @param [Integer] multiplier Applied to sum of dice, e.g. -1 when the dice are subtracted
+ *   @return [Float] in range (0.0..1.0)
+ */
+VALUE probabilities_fair_dice_p_ge( int argc, VALUE* argv, VALUE self ) {
+  return fair_dice_query( argc, argv, FD_GE, 0 );
+}
+
+/*
+ * @overload fair_dice_p_gt(ndice, sides, target, multiplier = 1)
+ *   Probability that the total of a number of fair dice, times a multiplier, is greater than a
+ *   specific target. See #fair_dice_p_eql.
+ *   @param [Integer] ndice Number of dice
+ *   @param [Integer] sides Number of sides on each die
+ *   @param [Integer] target
+ *   @param [Integer] multiplier Applied to sum of dice, e.g. -1 when the dice are subtracted
+ *   @return [Float] in range (0.0..1.0)
+ */
+VALUE probabilities_fair_dice_p_gt( int argc, VALUE* argv, VALUE self ) {
+  return fair_dice_query( argc, argv, FD_GE, 1 );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Add fair dice queries to Probabilities class
+//
+
+void init_fair_dice_queries() {
+  rb_define_singleton_method( Probabilities, "fair_dice_p_eql", probabilities_fair_dice_p_eql, -1 );
+  rb_define_singleton_method( Probabilities, "fair_dice_p_le", probabilities_fair_dice_p_le, -1 );
+  rb_define_singleton_method( Probabilities, "fair_dice_p_lt", probabilities_fair_dice_p_lt, -1 );
+  rb_define_singleton_method( Probabilities, "fair_dice_p_ge", probabilities_fair_dice_p_ge, -1 );
+  rb_define_singleton_method( Probabilities, "fair_dice_p_gt", probabilities_fair_dice_p_gt, -1 );
+  return;
+}
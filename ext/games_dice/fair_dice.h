@@ -0,0 +1,19 @@
+// ext/games_dice/fair_dice.h
+
+// definitions for point queries on sums of fair dice
+
+#ifndef FAIR_DICE_H
+#define FAIR_DICE_H
+
+#include <ruby.h>
+#include "probabilities.h"
+
+void init_fair_dice_queries();
+
+double fd_p_eql( int n, int s, long target );
+
+double fd_p_le( int n, int s, long target );
+
+double fd_p_ge( int n, int s, long target );
+
+#endif
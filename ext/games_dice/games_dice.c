@@ -2,6 +2,10 @@
 
 #include <ruby.h>
 #include "probabilities.h"
+#include "sampler.h"
+#include "fair_dice.h"
+#include "joint_probabilities.h"
+#include "mapped_probabilities.h"
 
 // To hold the module object
 VALUE GamesDice = Qnil;
@@ -9,4 +13,8 @@ VALUE GamesDice = Qnil;
 void Init_games_dice() {
   GamesDice = rb_define_module("GamesDice");
   init_probabilities_class();
+  init_sampler_class();
+  init_fair_dice_queries();
+  init_joint_probabilities_class();
+  init_mapped_probabilities_class();
 }
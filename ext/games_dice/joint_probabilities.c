@@ -0,0 +1,572 @@
+// ext/games_dice/joint_probabilities.c
+
+#include "joint_probabilities.h"
+
+// Ruby 1.8.7 compatibility patch
+#ifndef DBL2NUM
+#define DBL2NUM( dbl_val ) rb_float_new( dbl_val )
+#endif
+
+// Force inclusion of hash declarations (only MRI includes by default)
+#ifdef HAVE_RUBY_ST_H
+#include "ruby/st.h"
+#else
+#include "st.h"
+#endif
+
+VALUE JointProbabilities = Qnil;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Joint Probability List basics - create, delete, copy
+//
+
+// All allocations go through Ruby's xmalloc, so the GC already accounts for them
+JointProbabilityList *create_joint_probability_list() {
+  JointProbabilityList *jpl = ALLOC( JointProbabilityList );
+  jpl->probs = NULL;
+  jpl->t_offset = 0;
+  jpl->t_slots = 0;
+  jpl->m_offset = 0;
+  jpl->m_slots = 0;
+  return jpl;
+}
+
+void destroy_joint_probability_list( JointProbabilityList *jpl ) {
+  xfree( jpl->probs );
+  xfree( jpl );
+  return;
+}
+
+// Same overall limit as for a one-dimensional distribution. Raises, so callers check sizes before
+// allocating anything that is not yet owned by a Ruby object.
+static void check_joint_slots( int t_slots, int m_slots ) {
+  if ( t_slots < 1 || m_slots < 1 || (double) t_slots * m_slots > 1000000.0 ) {
+    rb_raise(rb_eArgError, "Bad number of probability slots");
+  }
+}
+
+double *alloc_joint_probs( JointProbabilityList *jpl, int t_slots, int m_slots ) {
+  int i;
+  check_joint_slots( t_slots, m_slots );
+  jpl->t_slots = t_slots;
+  jpl->m_slots = m_slots;
+  jpl->probs = ALLOC_N( double, t_slots * m_slots );
+  for ( i = 0; i < t_slots * m_slots; i++ ) {
+    jpl->probs[i] = 0.0;
+  }
+  return jpl->probs;
+}
+
+JointProbabilityList *copy_joint_probability_list( JointProbabilityList *orig ) {
+  JointProbabilityList *jpl = create_joint_probability_list();
+  alloc_joint_probs( jpl, orig->t_slots, orig->m_slots );
+  jpl->t_offset = orig->t_offset;
+  jpl->m_offset = orig->m_offset;
+  memcpy( jpl->probs, orig->probs, orig->t_slots * orig->m_slots * sizeof(double) );
+  return jpl;
+}
+
+// One-dimensional distribution from every stride'th value of vals, with zeros trimmed from
+// both ends, and scaled to a total of 1.0
+ProbabilityList *pl_from_strided( double *vals, int n, int stride, int offset ) {
+  ProbabilityList *pl;
+  double total = 0.0;
+  double mult;
+  int lo = 0, hi = n - 1;
+  int i;
+
+  while ( lo < n && vals[ lo * stride ] <= 0.0 ) lo++;
+  while ( hi > lo && vals[ hi * stride ] <= 0.0 ) hi--;
+  for ( i = lo; i <= hi; i++ ) {
+    total += vals[ i * stride ];
+  }
+  if ( total <= 0.0 ) {
+    rb_raise( rb_eRuntimeError, "Cannot calculate given probabilities, divide by zero" );
+  }
+
+  mult = 1.0 / total;
+  check_pl_error( new_basic_pl( 1 + hi - lo, 0.0, offset + lo, &pl ) );
+  for ( i = lo; i <= hi; i++ ) {
+    pl->probs[ i - lo ] = vals[ i * stride ] * mult;
+  }
+  calc_cumulative( pl );
+  return pl;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Joint Probability List core "native" methods
+//
+
+JointProbabilityList *jpl_add_distributions( JointProbabilityList *jpl_a, JointProbabilityList *jpl_b ) {
+  JointProbabilityList *jpl;
+  int ts = jpl_a->t_slots + jpl_b->t_slots - 1;
+  int ms = jpl_a->m_slots + jpl_b->m_slots - 1;
+  double *pr, *pr_a, *pr_b;
+  double p_a;
+  int ia, ja, ib, jb;
+
+  check_joint_slots( ts, ms );
+  jpl = create_joint_probability_list();
+  jpl->t_offset = jpl_a->t_offset + jpl_b->t_offset;
+  jpl->m_offset = jpl_a->m_offset + jpl_b->m_offset;
+  pr = alloc_joint_probs( jpl, ts, ms );
+  pr_a = jpl_a->probs;
+  pr_b = jpl_b->probs;
+
+  // Grids from dice are usually sparse (most totals map to a single value), so skipping zero
+  // cells in the outer loops saves most of the work
+  for ( ia = 0; ia < jpl_a->t_slots; ia++ ) { for ( ja = 0; ja < jpl_a->m_slots; ja++ ) {
+    p_a = pr_a[ ia * jpl_a->m_slots + ja ];
+    if ( p_a <= 0.0 ) continue;
+    for ( ib = 0; ib < jpl_b->t_slots; ib++ ) {
+      double *row_b = pr_b + ib * jpl_b->m_slots;
+      double *row = pr + ( ia + ib ) * ms + ja;
+      for ( jb = 0; jb < jpl_b->m_slots; jb++ ) {
+        row[ jb ] += p_a * row_b[ jb ];
+      }
+    }
+  } }
+  return jpl;
+}
+
+JointProbabilityList *jpl_repeat_sum( JointProbabilityList *jpl, int n ) {
+  JointProbabilityList *pd_power = NULL;
+  JointProbabilityList *pd_result = NULL;
+  JointProbabilityList *pd_next = NULL;
+  int power = 1;
+
+  if ( n < 1 ) {
+    rb_raise( rb_eRuntimeError, "Cannot calculate repeat_sum when n < 1" );
+  }
+  if ( ( (double) n * ( jpl->t_slots - 1 ) + 1.0 ) * ( (double) n * ( jpl->m_slots - 1 ) + 1.0 ) > 1000000.0 ) {
+    rb_raise( rb_eRuntimeError, "Too many probability slots" );
+  }
+
+  // Powers and partial sums below are no larger than the result, so cannot fail the size check
+  // while holding grids that are not yet owned by Ruby objects
+  pd_power = copy_joint_probability_list( jpl );
+
+  while ( 1 ) {
+    if ( power & n ) {
+      if ( pd_result ) {
+        pd_next = jpl_add_distributions( pd_result, pd_power );
+        destroy_joint_probability_list( pd_result );
+        pd_result = pd_next;
+      } else {
+        pd_result = copy_joint_probability_list( pd_power );
+      }
+    }
+    power = power << 1;
+    if ( power > n ) break;
+    pd_next = jpl_add_distributions( pd_power, pd_power );
+    destroy_joint_probability_list( pd_power );
+    pd_power = pd_next;
+  }
+  destroy_joint_probability_list( pd_power );
+
+  return pd_result;
+}
+
+ProbabilityList *jpl_total_marginal( JointProbabilityList *jpl ) {
+  double *sums = ALLOC_N( double, jpl->t_slots );
+  ProbabilityList *pl;
+  int i, j;
+  for ( i = 0; i < jpl->t_slots; i++ ) {
+    sums[i] = 0.0;
+    for ( j = 0; j < jpl->m_slots; j++ ) {
+      sums[i] += jpl->probs[ i * jpl->m_slots + j ];
+    }
+  }
+  pl = pl_from_strided( sums, jpl->t_slots, 1, jpl->t_offset );
+  xfree( sums );
+  return pl;
+}
+
+ProbabilityList *jpl_mapped_marginal( JointProbabilityList *jpl ) {
+  double *sums = ALLOC_N( double, jpl->m_slots );
+  ProbabilityList *pl;
+  int i, j;
+  for ( j = 0; j < jpl->m_slots; j++ ) {
+    sums[j] = 0.0;
+  }
+  for ( i = 0; i < jpl->t_slots; i++ ) {
+    for ( j = 0; j < jpl->m_slots; j++ ) {
+      sums[j] += jpl->probs[ i * jpl->m_slots + j ];
+    }
+  }
+  pl = pl_from_strided( sums, jpl->m_slots, 1, jpl->m_offset );
+  xfree( sums );
+  return pl;
+}
+
+ProbabilityList *jpl_given_total( JointProbabilityList *jpl, int total ) {
+  int i = total - jpl->t_offset;
+  if ( i < 0 || i >= jpl->t_slots ) {
+    rb_raise( rb_eRuntimeError, "Cannot calculate given probabilities, divide by zero" );
+  }
+  return pl_from_strided( jpl->probs + i * jpl->m_slots, jpl->m_slots, 1, jpl->m_offset );
+}
+
+ProbabilityList *jpl_given_mapped( JointProbabilityList *jpl, int mapped ) {
+  int j = mapped - jpl->m_offset;
+  if ( j < 0 || j >= jpl->m_slots ) {
+    rb_raise( rb_eRuntimeError, "Cannot calculate given probabilities, divide by zero" );
+  }
+  return pl_from_strided( jpl->probs + j, jpl->t_slots, jpl->m_slots, jpl->t_offset );
+}
+
+double jpl_p_eql( JointProbabilityList *jpl, int total, int mapped ) {
+  int i = total - jpl->t_offset;
+  int j = mapped - jpl->m_offset;
+  if ( i < 0 || i >= jpl->t_slots || j < 0 || j >= jpl->m_slots ) {
+    return 0.0;
+  }
+  return jpl->probs[ i * jpl->m_slots + j ];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Ruby integration
+//
+
+static void jpl_free( void *ptr ) {
+  destroy_joint_probability_list( (JointProbabilityList *) ptr );
+}
+
+static size_t jpl_dsize( const void *ptr ) {
+  const JointProbabilityList *jpl = (const JointProbabilityList *) ptr;
+  size_t size = sizeof(JointProbabilityList);
+  if ( jpl->probs ) size += (size_t) jpl->t_slots * jpl->m_slots * sizeof(double);
+  return size;
+}
+
+static const rb_data_type_t joint_probabilities_type = {
+  "GamesDice::JointProbabilities",
+  { 0, jpl_free, jpl_dsize, },
+  0, 0,
+  RUBY_TYPED_FREE_IMMEDIATELY
+};
+
+VALUE jpl_as_ruby_class( JointProbabilityList *jpl, VALUE klass ) {
+  return TypedData_Wrap_Struct( klass, &joint_probabilities_type, jpl );
+}
+
+VALUE jpl_alloc(VALUE klass) {
+  return jpl_as_ruby_class( create_joint_probability_list(), klass );
+}
+
+JointProbabilityList *get_joint_probability_list( VALUE obj ) {
+  JointProbabilityList *jpl;
+  TypedData_Get_Struct( obj, JointProbabilityList, &joint_probabilities_type, jpl );
+  return jpl;
+}
+
+void assert_value_wraps_jpl( VALUE obj ) {
+  if ( ! rb_typeddata_is_kind_of( obj, &joint_probabilities_type ) ) {
+    rb_raise( rb_eTypeError, "Expected a JointProbabilities object, but got something else" );
+  }
+}
+
+// Keys are [total, mapped] pairs
+void joint_key_from_value( VALUE key, int *total, int *mapped ) {
+  Check_Type( key, T_ARRAY );
+  if ( RARRAY_LEN( key ) != 2 ) {
+    rb_raise( rb_eArgError, "Expected key to be an Array of [total, mapped]" );
+  }
+  *total = NUM2INT( rb_ary_entry( key, 0 ) );
+  *mapped = NUM2INT( rb_ary_entry( key, 1 ) );
+}
+
+// Validate key/value from hash, and adjust bounds (held temporarily in offsets and slots)
+int validate_joint_key_value( VALUE key, VALUE val, VALUE obj ) {
+  int t, m;
+  JointProbabilityList *jpl = get_joint_probability_list( obj );
+  joint_key_from_value( key, &t, &m );
+  if ( NUM2DBL( val ) < 0.0 ) {
+    rb_raise( rb_eArgError, "Negative probability not allowed" );
+  }
+
+  if ( jpl->t_slots < 1 ) {
+    jpl->t_offset = t;
+    jpl->t_slots = 1;
+    jpl->m_offset = m;
+    jpl->m_slots = 1;
+    return ST_CONTINUE;
+  }
+  if ( t < jpl->t_offset ) {
+    jpl->t_slots += jpl->t_offset - t;
+    jpl->t_offset = t;
+  } else if ( t - jpl->t_offset >= jpl->t_slots ) {
+    jpl->t_slots = 1 + t - jpl->t_offset;
+  }
+  if ( m < jpl->m_offset ) {
+    jpl->m_slots += jpl->m_offset - m;
+    jpl->m_offset = m;
+  } else if ( m - jpl->m_offset >= jpl->m_slots ) {
+    jpl->m_slots = 1 + m - jpl->m_offset;
+  }
+  return ST_CONTINUE;
+}
+
+// Copy key/value from hash
+int copy_joint_key_value( VALUE key, VALUE val, VALUE obj ) {
+  int t, m;
+  JointProbabilityList *jpl = get_joint_probability_list( obj );
+  joint_key_from_value( key, &t, &m );
+  jpl->probs[ ( t - jpl->t_offset ) * jpl->m_slots + ( m - jpl->m_offset ) ] += NUM2DBL( val );
+  return ST_CONTINUE;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Ruby class and instance methods for JointProbabilities
+//
+
+/*
+ * @overload from_h(prob_hash)
+ *   Creates new instance of GamesDice::JointProbabilities.
+ *   @param [Hash] prob_hash Each key is an Array [total, mapped] of integer results, and the
+ *     matching value is probability of getting that pair of results
+ *   @return [GamesDice::JointProbabilities]
+ */
+VALUE joint_probabilities_from_h( VALUE self, VALUE hash ) {
+  VALUE obj;
+  JointProbabilityList *jpl;
+  double error = -1.0;
+  int i, t_slots, m_slots;
+
+  Check_Type( hash, T_HASH );
+
+  obj = jpl_alloc( JointProbabilities );
+  jpl = get_joint_probability_list( obj );
+
+  // First iteration establish bounds and validate all key/values
+  rb_hash_foreach( hash, validate_joint_key_value, obj );
+  t_slots = jpl->t_slots;
+  m_slots = jpl->m_slots;
+
+  alloc_joint_probs( jpl, t_slots, m_slots );
+  // Second iteration copy key/value pairs into structure
+  rb_hash_foreach( hash, copy_joint_key_value, obj );
+
+  for ( i = 0; i < t_slots * m_slots; i++ ) {
+    error += jpl->probs[i];
+  }
+  if ( error < -1.0e-8 ) {
+    rb_raise( rb_eArgError, "Total probabilities are less than 1.0" );
+  } else if ( error > 1.0e-8 ) {
+    rb_raise( rb_eArgError, "Total probabilities are greater than 1.0" );
+  }
+  return obj;
+}
+
+/*
+ * @overload clone
+ *   Cloning an object of this class creates a deep copy of the probabilities.
+ *   @return [GamesDice::JointProbabilities]
+ */
+VALUE joint_probabilities_initialize_copy( VALUE copy, VALUE orig ) {
+  JointProbabilityList *jpl_copy;
+  JointProbabilityList *jpl_orig;
+
+  if (copy == orig) return copy;
+  jpl_copy = get_joint_probability_list( copy );
+  jpl_orig = get_joint_probability_list( orig );
+
+  alloc_joint_probs( jpl_copy, jpl_orig->t_slots, jpl_orig->m_slots );
+  jpl_copy->t_offset = jpl_orig->t_offset;
+  jpl_copy->m_offset = jpl_orig->m_offset;
+  memcpy( jpl_copy->probs, jpl_orig->probs, jpl_orig->t_slots * jpl_orig->m_slots * sizeof(double) );
+
+  return copy;
+}
+
+/*
+ * A hash representation of the distribution. Each key is an Array [total, mapped], and the
+ * matching value is probability of getting that pair of results. A new hash is generated on each
+ * call to this method.
+ * @return [Hash]
+ */
+VALUE joint_probabilities_to_h( VALUE self ) {
+  JointProbabilityList *jpl = get_joint_probability_list( self );
+  VALUE h = rb_hash_new();
+  double p;
+  int i, j;
+  for ( i = 0; i < jpl->t_slots; i++ ) { for ( j = 0; j < jpl->m_slots; j++ ) {
+    p = jpl->probs[ i * jpl->m_slots + j ];
+    if ( p > 0.0 ) {
+      rb_hash_aset( h, rb_assoc_new( INT2NUM( jpl->t_offset + i ), INT2NUM( jpl->m_offset + j ) ), DBL2NUM( p ) );
+    }
+  } }
+  return h;
+}
+
+/*
+ * Iterates through total, mapped and probability
+ * @yieldparam [Array<Integer>] results Pair [total, mapped] that may be possible in the dice scheme
+ * @yieldparam [Float] probability Probability of results, in range 0.0..1.0
+ * @return [GamesDice::JointProbabilities] this object
+ */
+VALUE joint_probabilities_each( VALUE self ) {
+  JointProbabilityList *jpl = get_joint_probability_list( self );
+  double p;
+  int i, j;
+  for ( i = 0; i < jpl->t_slots; i++ ) { for ( j = 0; j < jpl->m_slots; j++ ) {
+    p = jpl->probs[ i * jpl->m_slots + j ];
+    if ( p > 0.0 ) {
+      VALUE a = rb_ary_new2( 2 );
+      rb_ary_store( a, 0, rb_assoc_new( INT2NUM( jpl->t_offset + i ), INT2NUM( jpl->m_offset + j ) ) );
+      rb_ary_store( a, 1, DBL2NUM( p ) );
+      rb_yield( a );
+    }
+  } }
+  return self;
+}
+
+/*
+ * Probability of total and mapped results both equalling specific targets
+ * @param [Integer] total
+ * @param [Integer] mapped
+ * @return [Float] in range (0.0..1.0)
+ */
+VALUE joint_probabilities_p_eql( VALUE self, VALUE total, VALUE mapped ) {
+  return DBL2NUM( jpl_p_eql( get_joint_probability_list( self ), NUM2INT(total), NUM2INT(mapped) ) );
+}
+
+/*
+ * Distribution of totals, ignoring mapped values
+ * @return [GamesDice::Probabilities]
+ */
+VALUE joint_probabilities_total_probabilities( VALUE self ) {
+  return pl_as_ruby_class( jpl_total_marginal( get_joint_probability_list( self ) ), Probabilities );
+}
+
+/*
+ * Distribution of mapped values, ignoring totals
+ * @return [GamesDice::Probabilities]
+ */
+VALUE joint_probabilities_mapped_probabilities( VALUE self ) {
+  return pl_as_ruby_class( jpl_mapped_marginal( get_joint_probability_list( self ) ), Probabilities );
+}
+
+/*
+ * Distribution of mapped values, where we know (or are only interested in situations where) the
+ * total equals target.
+ * @param [Integer] total
+ * @return [GamesDice::Probabilities] new distribution.
+ */
+VALUE joint_probabilities_given_total( VALUE self, VALUE total ) {
+  return pl_as_ruby_class( jpl_given_total( get_joint_probability_list( self ), NUM2INT(total) ), Probabilities );
+}
+
+/*
+ * Distribution of totals, where we know (or are only interested in situations where) the
+ * mapped value equals target.
+ * @param [Integer] mapped
+ * @return [GamesDice::Probabilities] new distribution.
+ */
+VALUE joint_probabilities_given_mapped( VALUE self, VALUE mapped ) {
+  return pl_as_ruby_class( jpl_given_mapped( get_joint_probability_list( self ), NUM2INT(mapped) ), Probabilities );
+}
+
+/*
+ * @overload repeat_sum(n)
+ *   Adds a distribution to itself repeatedly, to simulate a number of dice results being summed.
+ *   Totals and mapped values are summed separately.
+ *   @param [Integer] n Number of repetitions, must be at least 1
+ *   @return [GamesDice::JointProbabilities] new distribution
+ */
+VALUE joint_probabilities_repeat_sum( VALUE self, VALUE nsum ) {
+  int n = NUM2INT(nsum);
+  JointProbabilityList *jpl = get_joint_probability_list( self );
+  return jpl_as_ruby_class( jpl_repeat_sum( jpl, n ), JointProbabilities );
+}
+
+/*
+ * @overload add_distributions(jpd_a, jpd_b)
+ *   Combines two joint distributions to create a third, that represents the distribution created
+ *   when adding totals and mapped values together.
+ *   @param [GamesDice::JointProbabilities] jpd_a First distribution
+ *   @param [GamesDice::JointProbabilities] jpd_b Second distribution
+ *   @return [GamesDice::JointProbabilities]
+ */
+VALUE joint_probabilities_add_distributions( VALUE self, VALUE gdjpa, VALUE gdjpb ) {
+  JointProbabilityList *jpl_a;
+  JointProbabilityList *jpl_b;
+  assert_value_wraps_jpl( gdjpa );
+  assert_value_wraps_jpl( gdjpb );
+  jpl_a = get_joint_probability_list( gdjpa );
+  jpl_b = get_joint_probability_list( gdjpb );
+  return jpl_as_ruby_class( jpl_add_distributions( jpl_a, jpl_b ), JointProbabilities );
+}
+
+/*
+ * @overload total_min
+ *   @!attribute [r] total_min
+ *   Minimum total in the distribution
+ *   @return [Integer]
+ */
+VALUE joint_probabilities_total_min( VALUE self ) {
+  return INT2NUM( get_joint_probability_list( self )->t_offset );
+}
+
+/*
+ * @overload total_max
+ *   @!attribute [r] total_max
+ *   Maximum total in the distribution
+ *   @return [Integer]
+ */
+VALUE joint_probabilities_total_max( VALUE self ) {
+  JointProbabilityList *jpl = get_joint_probability_list( self );
+  return INT2NUM( jpl->t_offset + jpl->t_slots - 1 );
+}
+
+/*
+ * @overload mapped_min
+ *   @!attribute [r] mapped_min
+ *   Minimum mapped value in the distribution
+ *   @return [Integer]
+ */
+VALUE joint_probabilities_mapped_min( VALUE self ) {
+  return INT2NUM( get_joint_probability_list( self )->m_offset );
+}
+
+/*
+ * @overload mapped_max
+ *   @!attribute [r] mapped_max
+ *   Maximum mapped value in the distribution
+ *   @return [Integer]
+ */
+VALUE joint_probabilities_mapped_max( VALUE self ) {
+  JointProbabilityList *jpl = get_joint_probability_list( self );
+  return INT2NUM( jpl->m_offset + jpl->m_slots - 1 );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Setup JointProbabilities class for Ruby interpretter
+//
+
+void init_joint_probabilities_class() {
+  VALUE GamesDice = rb_define_module("GamesDice");
+  JointProbabilities = rb_define_class_under( GamesDice, "JointProbabilities", rb_cObject );
+  rb_define_alloc_func( JointProbabilities, jpl_alloc );
+  rb_define_method( JointProbabilities, "initialize_copy", joint_probabilities_initialize_copy, 1 );
+  rb_define_method( JointProbabilities, "to_h", joint_probabilities_to_h, 0 );
+  rb_define_method( JointProbabilities, "each", joint_probabilities_each, 0 );
+  rb_define_method( JointProbabilities, "p_eql", joint_probabilities_p_eql, 2 );
+  rb_define_method( JointProbabilities, "total_min", joint_probabilities_total_min, 0 );
+  rb_define_method( JointProbabilities, "total_max", joint_probabilities_total_max, 0 );
+  rb_define_method( JointProbabilities, "mapped_min", joint_probabilities_mapped_min, 0 );
+  rb_define_method( JointProbabilities, "mapped_max", joint_probabilities_mapped_max, 0 );
+  rb_define_method( JointProbabilities, "total_probabilities", joint_probabilities_total_probabilities, 0 );
+  rb_define_method( JointProbabilities, "mapped_probabilities", joint_probabilities_mapped_probabilities, 0 );
+  rb_define_method( JointProbabilities, "given_total", joint_probabilities_given_total, 1 );
+  rb_define_method( JointProbabilities, "given_mapped", joint_probabilities_given_mapped, 1 );
+  rb_define_method( JointProbabilities, "repeat_sum", joint_probabilities_repeat_sum, 1 );
+  rb_define_singleton_method( JointProbabilities, "add_distributions", joint_probabilities_add_distributions, 2 );
+  rb_define_singleton_method( JointProbabilities, "from_h", joint_probabilities_from_h, 1 );
+  return;
+}
@@ -0,0 +1,35 @@
+// ext/games_dice/joint_probabilities.h
+
+// definitions for JointProbabilities class
+
+#ifndef JOINT_PROBABILITIES_H
+#define JOINT_PROBABILITIES_H
+
+#include <ruby.h>
+#include "probabilities.h"
+
+void init_joint_probabilities_class();
+
+// Dense grid of probabilities for pairs of results (total, mapped). The cell for total
+// t_offset + i and mapped value m_offset + j is at probs[ i * m_slots + j ]
+typedef struct _jd {
+    int t_offset;
+    int t_slots;
+    int m_offset;
+    int m_slots;
+    double *probs;
+  } JointProbabilityList;
+
+JointProbabilityList *jpl_add_distributions( JointProbabilityList *jpl_a, JointProbabilityList *jpl_b );
+
+JointProbabilityList *jpl_repeat_sum( JointProbabilityList *jpl, int n );
+
+ProbabilityList *jpl_total_marginal( JointProbabilityList *jpl );
+
+ProbabilityList *jpl_mapped_marginal( JointProbabilityList *jpl );
+
+ProbabilityList *jpl_given_total( JointProbabilityList *jpl, int total );
+
+ProbabilityList *jpl_given_mapped( JointProbabilityList *jpl, int mapped );
+
+#endif
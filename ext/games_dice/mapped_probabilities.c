@@ -0,0 +1,345 @@
+// ext/games_dice/mapped_probabilities.c
+
+#include "mapped_probabilities.h"
+#include <ruby/thread.h>
+
+// Ruby 1.8.7 compatibility patch
+#ifndef DBL2NUM
+#define DBL2NUM( dbl_val ) rb_float_new( dbl_val )
+#endif
+
+VALUE MappedProbabilities = Qnil;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Ruby integration
+//
+
+static void mpl_free( void *ptr ) {
+  destroy_mapped_probability_list( (MappedProbabilityList *) ptr );
+}
+
+// Only the struct and path are held in memory, the probabilities stay in the file
+static size_t mpl_memsize( const void *ptr ) {
+  const MappedProbabilityList *mpl = (const MappedProbabilityList *) ptr;
+  return sizeof(MappedProbabilityList) + ( mpl->path ? strlen( mpl->path ) + 1 : 0 );
+}
+
+static const rb_data_type_t mapped_probabilities_type = {
+  "GamesDice::MappedProbabilities",
+  { 0, mpl_free, mpl_memsize, },
+  0, 0,
+  RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+MappedProbabilityList *get_mapped_probability_list( VALUE obj ) {
+  MappedProbabilityList *mpl;
+  TypedData_Get_Struct( obj, MappedProbabilityList, &mapped_probabilities_type, mpl );
+  return mpl;
+}
+
+static VALUE mpl_as_ruby_class( MappedProbabilityList *mpl ) {
+  return TypedData_Wrap_Struct( MappedProbabilities, &mapped_probabilities_type, mpl );
+}
+
+static const char *path_or_null( VALUE path ) {
+  if ( NIL_P( path ) ) return NULL;
+  return StringValueCStr( path );
+}
+
+static long budget_from_value( VALUE memory_budget ) {
+  long budget;
+  if ( NIL_P( memory_budget ) ) return MPL_DEFAULT_BUDGET;
+  budget = NUM2LONG( memory_budget );
+  if ( budget < 1 ) {
+    rb_raise( rb_eArgError, "Memory budget should be 1 or more bytes" );
+  }
+  return budget;
+}
+
+static void assert_value_is_operand( VALUE obj ) {
+  if ( ! rb_typeddata_is_kind_of( obj, &mapped_probabilities_type ) ) {
+    assert_value_wraps_pl( obj );
+  }
+}
+
+// Operands can be mapped already, or an in-memory GamesDice::Probabilities, which is written
+// to a temporary file. Any temporary is returned in *tmp, and must be destroyed by the caller.
+// Does not raise, so that callers can clean up after an error in a later operand.
+static int mapped_operand( VALUE obj, MappedProbabilityList **mpl, MappedProbabilityList **tmp ) {
+  int err;
+  *tmp = NULL;
+  if ( rb_typeddata_is_kind_of( obj, &mapped_probabilities_type ) ) {
+    *mpl = get_mapped_probability_list( obj );
+    return GD_OK;
+  }
+  err = mpl_from_probability_list( get_probability_list( obj ), NULL, tmp );
+  *mpl = *tmp;
+  return err;
+}
+
+// Convolutions can take minutes, so they run without the GVL. Ruby interrupts (e.g. Ctrl-C or
+// Thread#kill) set cancel, and the calculation stops at the end of its current block.
+typedef struct _mc {
+    MappedProbabilityList *a;
+    MappedProbabilityList *b;
+    long long n;
+    const char *path;
+    long budget;
+    volatile int cancel;
+    MappedProbabilityList *result;
+  } MappedCalculation;
+
+static void *add_distributions_without_gvl( void *ptr ) {
+  MappedCalculation *mc = (MappedCalculation *) ptr;
+  return (void *) (intptr_t) mpl_add_distributions( mc->a, mc->b, mc->path, mc->budget,
+      &mc->cancel, &mc->result );
+}
+
+static void *repeat_sum_without_gvl( void *ptr ) {
+  MappedCalculation *mc = (MappedCalculation *) ptr;
+  return (void *) (intptr_t) mpl_repeat_sum( mc->a, mc->n, mc->path, mc->budget, &mc->cancel,
+      &mc->result );
+}
+
+static void cancel_calculation( void *ptr ) {
+  ( (MappedCalculation *) ptr )->cancel = 1;
+}
+
+static int run_calculation( void *(*func)( void * ), MappedCalculation *mc ) {
+  mc->cancel = 0;
+  mc->result = NULL;
+  return (int) (intptr_t) rb_thread_call_without_gvl( func, mc, cancel_calculation, mc );
+}
+
+// Raises the pending interrupt that stopped a calculation, or any other error
+static void check_calculation_error( int err ) {
+  if ( err == GD_ERR_INTERRUPTED ) rb_thread_check_ints();
+  check_pl_error( err );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Ruby class and instance methods for MappedProbabilities
+//
+
+/*
+ * Distribution for a die with equal chance of rolling 1..N, which may have more sides than
+ * GamesDice::Probabilities allows.
+ * @overload for_fair_die(sides, path = nil)
+ *   @param [Integer] sides Number of sides on die
+ *   @param [String,nil] path File to write, or nil for a temporary file
+ *   @return [GamesDice::MappedProbabilities]
+ */
+VALUE mapped_probabilities_for_fair_die( int argc, VALUE* argv, VALUE self ) {
+  VALUE sides, path;
+  MappedProbabilityList *mpl;
+  rb_scan_args( argc, argv, "11", &sides, &path );
+  check_pl_error( mpl_for_fair_die( NUM2LL( sides ), path_or_null( path ), MPL_DEFAULT_BUDGET, &mpl ) );
+  return mpl_as_ruby_class( mpl );
+}
+
+/*
+ * Opens a distribution previously written to a file.
+ * @param [String] path File to read
+ * @return [GamesDice::MappedProbabilities]
+ */
+VALUE mapped_probabilities_open( VALUE self, VALUE path ) {
+  MappedProbabilityList *mpl;
+  check_pl_error( mpl_open( StringValueCStr( path ), &mpl ) );
+  return mpl_as_ruby_class( mpl );
+}
+
+/*
+ * Combines two distributions to create a third, that represents the distribution created when
+ * adding results together. The convolution works through both operands in blocks, so memory
+ * use is limited by memory_budget rather than by the size of the result. Other threads run
+ * meanwhile, and the calculation can be interrupted. A file at path is only replaced once the
+ * result is complete, so path may be that of an operand.
+ * @overload add_distributions(pd_a, pd_b, path = nil, memory_budget = nil)
+ *   @param [GamesDice::MappedProbabilities,GamesDice::Probabilities] pd_a First distribution
+ *   @param [GamesDice::MappedProbabilities,GamesDice::Probabilities] pd_b Second distribution
+ *   @param [String,nil] path File to write, or nil for a temporary file
+ *   @param [Integer,nil] memory_budget Approximate bytes of memory to use, default 64MB
+ *   @return [GamesDice::MappedProbabilities]
+ */
+VALUE mapped_probabilities_add_distributions( int argc, VALUE* argv, VALUE self ) {
+  VALUE gdpa, gdpb, path, memory_budget;
+  MappedProbabilityList *tmp_a = NULL, *tmp_b = NULL;
+  MappedCalculation mc;
+  int err;
+
+  rb_scan_args( argc, argv, "22", &gdpa, &gdpb, &path, &memory_budget );
+  mc.budget = budget_from_value( memory_budget );
+  mc.path = path_or_null( path );
+
+  assert_value_is_operand( gdpa );
+  assert_value_is_operand( gdpb );
+  err = mapped_operand( gdpa, &mc.a, &tmp_a );
+  if ( ! err ) err = mapped_operand( gdpb, &mc.b, &tmp_b );
+  if ( ! err ) err = run_calculation( add_distributions_without_gvl, &mc );
+  if ( tmp_a ) destroy_mapped_probability_list( tmp_a );
+  if ( tmp_b ) destroy_mapped_probability_list( tmp_b );
+  RB_GC_GUARD( path );
+  check_calculation_error( err );
+  return mpl_as_ruby_class( mc.result );
+}
+
+/*
+ * Calculates distribution generated by summing n results of a distribution, working through
+ * files in blocks so that the result can be larger than GamesDice::Probabilities allows. As for
+ * add_distributions, the calculation can be interrupted, and path is only replaced when complete.
+ * @overload repeat_sum(pd, n, path = nil, memory_budget = nil)
+ *   @param [GamesDice::MappedProbabilities,GamesDice::Probabilities] pd Distribution to repeat
+ *   @param [Integer] n Number of repetitions, must be at least 1
+ *   @param [String,nil] path File to write, or nil for a temporary file
+ *   @param [Integer,nil] memory_budget Approximate bytes of memory to use, default 64MB
+ *   @return [GamesDice::MappedProbabilities]
+ */
+VALUE mapped_probabilities_repeat_sum( int argc, VALUE* argv, VALUE self ) {
+  VALUE gdp, nsum, path, memory_budget;
+  MappedProbabilityList *tmp;
+  MappedCalculation mc;
+  int err;
+
+  rb_scan_args( argc, argv, "22", &gdp, &nsum, &path, &memory_budget );
+  mc.n = NUM2LL( nsum );
+  mc.budget = budget_from_value( memory_budget );
+  mc.path = path_or_null( path );
+
+  assert_value_is_operand( gdp );
+  err = mapped_operand( gdp, &mc.a, &tmp );
+  if ( ! err ) err = run_calculation( repeat_sum_without_gvl, &mc );
+  if ( tmp ) destroy_mapped_probability_list( tmp );
+  RB_GC_GUARD( path );
+  check_calculation_error( err );
+  return mpl_as_ruby_class( mc.result );
+}
+
+/*
+ * Minimum result in the distribution
+ * @return [Integer]
+ */
+VALUE mapped_probabilities_min( VALUE self ) {
+  return LL2NUM( mpl_min( get_mapped_probability_list( self ) ) );
+}
+
+/*
+ * Maximum result in the distribution
+ * @return [Integer]
+ */
+VALUE mapped_probabilities_max( VALUE self ) {
+  return LL2NUM( mpl_max( get_mapped_probability_list( self ) ) );
+}
+
+/*
+ * Probability of distribution having exactly value given by target
+ * @param [Integer] target
+ * @return [Float] in range (0.0..1.0)
+ */
+VALUE mapped_probabilities_p_eql( VALUE self, VALUE target ) {
+  double p;
+  check_pl_error( mpl_p_eql( get_mapped_probability_list( self ), NUM2LL( target ), &p ) );
+  return DBL2NUM( p );
+}
+
+/*
+ * Probability of distribution having a value greater than target. Reads the file each time.
+ * @param [Integer] target
+ * @return [Float] in range (0.0..1.0)
+ */
+VALUE mapped_probabilities_p_gt( VALUE self, VALUE target ) {
+  double p;
+  check_pl_error( mpl_p_gt( get_mapped_probability_list( self ), NUM2LL( target ),
+      MPL_DEFAULT_BUDGET, &p ) );
+  return DBL2NUM( p );
+}
+
+/*
+ * Probability of distribution having a value greater than or equal to target. Reads the file
+ * each time.
+ * @param [Integer] target
+ * @return [Float] in range (0.0..1.0)
+ */
+VALUE mapped_probabilities_p_ge( VALUE self, VALUE target ) {
+  double p;
+  check_pl_error( mpl_p_gt( get_mapped_probability_list( self ), NUM2LL( target ) - 1,
+      MPL_DEFAULT_BUDGET, &p ) );
+  return DBL2NUM( p );
+}
+
+/*
+ * Probability of distribution having a value less than or equal to target. Reads the file
+ * each time.
+ * @param [Integer] target
+ * @return [Float] in range (0.0..1.0)
+ */
+VALUE mapped_probabilities_p_le( VALUE self, VALUE target ) {
+  double p;
+  check_pl_error( mpl_p_le( get_mapped_probability_list( self ), NUM2LL( target ),
+      MPL_DEFAULT_BUDGET, &p ) );
+  return DBL2NUM( p );
+}
+
+/*
+ * Probability of distribution having a value less than target. Reads the file each time.
+ * @param [Integer] target
+ * @return [Float] in range (0.0..1.0)
+ */
+VALUE mapped_probabilities_p_lt( VALUE self, VALUE target ) {
+  double p;
+  check_pl_error( mpl_p_le( get_mapped_probability_list( self ), NUM2LL( target ) - 1,
+      MPL_DEFAULT_BUDGET, &p ) );
+  return DBL2NUM( p );
+}
+
+/*
+ * Expected value of distribution. Reads the file each time.
+ * @return [Float]
+ */
+VALUE mapped_probabilities_expected( VALUE self ) {
+  double e;
+  check_pl_error( mpl_expected( get_mapped_probability_list( self ), MPL_DEFAULT_BUDGET, &e ) );
+  return DBL2NUM( e );
+}
+
+/*
+ * File holding the distribution, or nil if it is an unlinked temporary file
+ * @return [String,nil]
+ */
+VALUE mapped_probabilities_path( VALUE self ) {
+  MappedProbabilityList *mpl = get_mapped_probability_list( self );
+  return mpl->path ? rb_str_new2( mpl->path ) : Qnil;
+}
+
+/*
+ * Reads the whole distribution into memory. Raises an error if there are more results than
+ * GamesDice::Probabilities allows.
+ * @return [GamesDice::Probabilities]
+ */
+VALUE mapped_probabilities_to_probabilities( VALUE self ) {
+  ProbabilityList *pl;
+  check_pl_error( mpl_to_probability_list( get_mapped_probability_list( self ), &pl ) );
+  return pl_as_ruby_class( pl, Probabilities );
+}
+
+void init_mapped_probabilities_class() {
+  VALUE GamesDice = rb_define_module("GamesDice");
+  MappedProbabilities = rb_define_class_under( GamesDice, "MappedProbabilities", rb_cObject );
+  rb_undef_alloc_func( MappedProbabilities );
+  rb_define_method( MappedProbabilities, "min", mapped_probabilities_min, 0 );
+  rb_define_method( MappedProbabilities, "max", mapped_probabilities_max, 0 );
+  rb_define_method( MappedProbabilities, "p_eql", mapped_probabilities_p_eql, 1 );
+  rb_define_method( MappedProbabilities, "p_gt", mapped_probabilities_p_gt, 1 );
+  rb_define_method( MappedProbabilities, "p_ge", mapped_probabilities_p_ge, 1 );
+  rb_define_method( MappedProbabilities, "p_le", mapped_probabilities_p_le, 1 );
+  rb_define_method( MappedProbabilities, "p_lt", mapped_probabilities_p_lt, 1 );
+  rb_define_method( MappedProbabilities, "expected", mapped_probabilities_expected, 0 );
+  rb_define_method( MappedProbabilities, "path", mapped_probabilities_path, 0 );
+  rb_define_method( MappedProbabilities, "to_probabilities", mapped_probabilities_to_probabilities, 0 );
+  rb_define_singleton_method( MappedProbabilities, "for_fair_die", mapped_probabilities_for_fair_die, -1 );
+  rb_define_singleton_method( MappedProbabilities, "open", mapped_probabilities_open, 1 );
+  rb_define_singleton_method( MappedProbabilities, "add_distributions", mapped_probabilities_add_distributions, -1 );
+  rb_define_singleton_method( MappedProbabilities, "repeat_sum", mapped_probabilities_repeat_sum, -1 );
+  return;
+}
@@ -0,0 +1,18 @@
+// ext/games_dice/mapped_probabilities.h
+
+// definitions for MappedProbabilities class
+
+#ifndef MAPPED_PROBABILITIES_H
+#define MAPPED_PROBABILITIES_H
+
+#include <ruby.h>
+#include "probabilities.h"
+#include "mapped_probability_list.h"
+
+void init_mapped_probabilities_class();
+
+extern VALUE MappedProbabilities;
+
+MappedProbabilityList *get_mapped_probability_list( VALUE obj );
+
+#endif
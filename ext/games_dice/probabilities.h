@@ -6,42 +6,20 @@
 #define PROBABILITIES_H
 
 #include <ruby.h>
+#include "probability_list.h"
 
 void init_probabilities_class();
 
-typedef struct _pd {
-    int offset;
-    int slots;
-    double *probs;
-    double *cumulative;
-  } ProbabilityList;
+extern VALUE Probabilities;
 
-inline int pl_min( ProbabilityList *pl );
+void check_pl_error( int err );
 
-inline int pl_max( ProbabilityList *pl );
+void pl_update_gc_memory( ProbabilityList *pl );
 
-ProbabilityList *pl_add_distributions( ProbabilityList *pl_a, ProbabilityList *pl_b );
+VALUE pl_as_ruby_class( ProbabilityList *pl, VALUE klass );
 
-ProbabilityList *pl_add_distributions_mult( int mul_a, ProbabilityList *pl_a, int mul_b, ProbabilityList *pl_b );
+ProbabilityList *get_probability_list( VALUE obj );
 
-inline double pl_p_eql( ProbabilityList *pl, int target );
-
-inline double pl_p_gt( ProbabilityList *pl, int target );
-
-inline double pl_p_lt( ProbabilityList *pl, int target );
-
-inline double pl_p_le( ProbabilityList *pl, int target );
-
-inline double pl_p_ge( ProbabilityList *pl, int target );
-
-inline double pl_expected( ProbabilityList *pl );
-
-ProbabilityList *pl_given_ge( ProbabilityList *pl, int target );
-
-ProbabilityList *pl_given_le( ProbabilityList *pl, int target );
-
-ProbabilityList *pl_repeat_sum( ProbabilityList *pl, int n );
-
-ProbabilityList *pl_repeat_n_sum_k( ProbabilityList *pl, int n, int k, int kbest );
+void assert_value_wraps_pl( VALUE obj );
 
 #endif
@@ -0,0 +1,402 @@
+// ext/games_dice/sampler.c
+
+#include "sampler.h"
+
+VALUE Sampler = Qnil;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Random numbers. The native generator is xoshiro256**, which is fast and has no trouble with
+//  the sample sizes used here. Ruby objects with a #rand method are supported too, at the cost
+//  of two method calls per sample.
+//
+
+static inline uint64_t rotl( const uint64_t x, int k ) {
+  return ( x << k ) | ( x >> ( 64 - k ) );
+}
+
+static uint64_t splitmix64( uint64_t *x ) {
+  uint64_t z = ( *x += 0x9e3779b97f4a7c15ULL );
+  z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+  z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+  return z ^ ( z >> 31 );
+}
+
+void rng_seed( SamplerRNG *rng, uint64_t seed ) {
+  int i;
+  for ( i = 0; i < 4; i++ ) {
+    rng->s[i] = splitmix64( &seed );
+  }
+}
+
+static inline uint64_t rng_next( SamplerRNG *rng ) {
+  uint64_t *s = rng->s;
+  const uint64_t result = rotl( s[1] * 5, 7 ) * 9;
+  const uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl( s[3], 45 );
+  return result;
+}
+
+// Uniform double in range 0.0...1.0 with 53 bits of precision
+static inline double rng_next_double( SamplerRNG *rng ) {
+  return ( rng_next( rng ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Alias table basics - create, delete
+//
+
+// All allocations go through Ruby's xmalloc, so the GC already accounts for them
+AliasSampler *create_alias_sampler() {
+  AliasSampler *as = ALLOC( AliasSampler );
+  as->keep = NULL;
+  as->alias = NULL;
+  as->slots = 0;
+  as->offset = 0;
+  as->stride = 1;
+  as->source = Qnil;
+  return as;
+}
+
+void destroy_alias_sampler( AliasSampler *as ) {
+  xfree( as->keep );
+  xfree( as->alias );
+  xfree( as );
+  return;
+}
+
+// Vose's method: O(slots) to build, then every draw is O(1) regardless of distribution shape.
+// Probabilities are read with pl_p_eql, so compact storage and views need no expanded copy.
+// Any old tables are freed, and the new ones belong to as before the scratch stack is allocated,
+// so nothing leaks if an allocation fails part way through.
+void as_build_table( AliasSampler *as, ProbabilityList *pl ) {
+  int s = pl->slots;
+  int *work;
+  int n_small = 0, n_large = 0;
+  int i, l, g;
+  double *scaled;
+  double total = 0.0;
+
+  xfree( as->keep );
+  xfree( as->alias );
+  as->keep = NULL;
+  as->alias = NULL;
+  as->slots = 0;
+  as->keep = ALLOC_N( double, s );
+  as->alias = ALLOC_N( int, s );
+  // Small columns are stacked from the start of work, and large ones from the end
+  work = ALLOC_N( int, s );
+
+  // Scaled probabilities are kept in place, because keep[l] is final once l leaves the small stack.
+  // They are scaled by their own total, which may differ slightly from 1.0 for compact storage
+  scaled = as->keep;
+  for ( i = 0; i < s; i++ ) {
+    scaled[i] = pl_p_eql( pl, pl->offset + i * pl->stride );
+    total += scaled[i];
+  }
+  for ( i = 0; i < s; i++ ) {
+    scaled[i] = scaled[i] * s / total;
+    if ( scaled[i] < 1.0 ) {
+      work[ n_small++ ] = i;
+    } else {
+      work[ s - ++n_large ] = i;
+    }
+  }
+
+  while ( n_small > 0 && n_large > 0 ) {
+    l = work[ --n_small ];
+    g = work[ s - n_large-- ];
+    as->alias[l] = g;
+    scaled[g] = ( scaled[g] + scaled[l] ) - 1.0;
+    if ( scaled[g] < 1.0 ) {
+      work[ n_small++ ] = g;
+    } else {
+      work[ s - ++n_large ] = g;
+    }
+  }
+
+  // Anything left over is due to rounding, and should be kept with certainty
+  while ( n_large > 0 ) {
+    g = work[ s - n_large-- ];
+    as->keep[g] = 1.0;
+    as->alias[g] = g;
+  }
+  while ( n_small > 0 ) {
+    l = work[ --n_small ];
+    as->keep[l] = 1.0;
+    as->alias[l] = l;
+  }
+
+  xfree( work );
+  as->slots = s;
+  as->offset = pl->offset;
+  as->stride = pl->stride;
+  return;
+}
+
+// A single uniform value u selects both the column (integer part of u * slots) and whether
+// to use the alias (fractional part)
+inline int as_draw( AliasSampler *as, double u ) {
+  double x = u * as->slots;
+  int i = (int) x;
+  if ( i >= as->slots ) {
+    i = as->slots - 1;
+  }
+  if ( x - i < as->keep[i] ) {
+    return as->offset + i * as->stride;
+  }
+  return as->offset + as->alias[i] * as->stride;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Ruby integration
+//
+
+// The source distribution is marked as movable, and its reference updated after compaction
+static void as_mark( void *ptr ) {
+  AliasSampler *as = (AliasSampler *) ptr;
+#ifdef HAVE_RB_GC_MARK_MOVABLE
+  rb_gc_mark_movable( as->source );
+#else
+  rb_gc_mark( as->source );
+#endif
+}
+
+#ifdef HAVE_RB_GC_MARK_MOVABLE
+static void as_compact( void *ptr ) {
+  AliasSampler *as = (AliasSampler *) ptr;
+  as->source = rb_gc_location( as->source );
+}
+#endif
+
+static void as_free( void *ptr ) {
+  destroy_alias_sampler( (AliasSampler *) ptr );
+}
+
+static size_t as_dsize( const void *ptr ) {
+  const AliasSampler *as = (const AliasSampler *) ptr;
+  size_t size = sizeof(AliasSampler);
+  if ( as->keep ) size += as->slots * sizeof(double);
+  if ( as->alias ) size += as->slots * sizeof(int);
+  return size;
+}
+
+static const rb_data_type_t sampler_type = {
+  "GamesDice::Probabilities::Sampler",
+  { as_mark, as_free, as_dsize,
+#ifdef HAVE_RB_GC_MARK_MOVABLE
+    as_compact,
+#endif
+  },
+  0, 0,
+  RUBY_TYPED_FREE_IMMEDIATELY
+};
+
+VALUE as_as_ruby_class( AliasSampler *as, VALUE klass ) {
+  return TypedData_Wrap_Struct( klass, &sampler_type, as );
+}
+
+VALUE as_alloc(VALUE klass) {
+  return as_as_ruby_class( create_alias_sampler(), klass );
+}
+
+AliasSampler *get_alias_sampler( VALUE obj ) {
+  AliasSampler *as;
+  TypedData_Get_Struct( obj, AliasSampler, &sampler_type, as );
+  return as;
+}
+
+// Source of randomness for a call to #sample or #histogram. Either native, seeded from an Integer
+// (or from Ruby's default generator when nil), or an object that supports rand(Integer)
+typedef struct _su {
+    SamplerRNG rng;
+    VALUE prng;
+    int slots;
+  } SampleSource;
+
+void init_sample_source( SampleSource *src, VALUE prng, int slots ) {
+  uint64_t seed;
+  src->prng = Qnil;
+  src->slots = slots;
+
+  if ( NIL_P(prng) ) {
+    seed = ( (uint64_t) rb_genrand_int32() << 32 ) | rb_genrand_int32();
+  } else if ( RB_INTEGER_TYPE_P(prng) ) {
+    seed = NUM2ULL( prng );
+  } else if ( rb_respond_to( prng, rb_intern("rand") ) ) {
+    src->prng = prng;
+    return;
+  } else {
+    rb_raise( rb_eTypeError, "prng should be nil, an Integer seed, or support the rand() method" );
+  }
+  rng_seed( &(src->rng), seed );
+}
+
+static inline double next_uniform( SampleSource *src ) {
+  int col;
+  double frac;
+  if ( NIL_P(src->prng) ) {
+    return rng_next_double( &(src->rng) );
+  }
+  col = NUM2INT( rb_funcall( src->prng, rb_intern("rand"), 1, INT2NUM( src->slots ) ) );
+  frac = NUM2DBL( rb_funcall( src->prng, rb_intern("rand"), 1, INT2NUM( 0x40000000 ) ) ) / 1073741824.0;
+  return ( col + frac ) / src->slots;
+}
+
+long sample_count( VALUE num ) {
+  long n = NUM2LONG( num );
+  if ( n < 0 ) {
+    rb_raise( rb_eArgError, "Number of samples should be 0 or more" );
+  }
+  return n;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Ruby class and instance methods for Probabilities::Sampler
+//
+
+/*
+ * @overload initialize(probabilities)
+ *   Creates new instance of GamesDice::Probabilities::Sampler. The alias table is built once,
+ *   in time proportional to the number of results in the distribution.
+ *   @param [GamesDice::Probabilities] probabilities Distribution to sample from
+ *   @return [GamesDice::Probabilities::Sampler]
+ */
+VALUE sampler_initialize( VALUE self, VALUE gdp ) {
+  AliasSampler *as = get_alias_sampler( self );
+  ProbabilityList *pl;
+  assert_value_wraps_pl( gdp );
+  pl = get_probability_list( gdp );
+  if ( pl->slots < 1 ) {
+    rb_raise( rb_eArgError, "Cannot sample from an empty distribution" );
+  }
+  as_build_table( as, pl );
+  as->source = gdp;
+  return self;
+}
+
+/*
+ * @overload probabilities
+ *   @!attribute [r] probabilities
+ *   The distribution that this sampler draws from
+ *   @return [GamesDice::Probabilities]
+ */
+VALUE sampler_probabilities( VALUE self ) {
+  return get_alias_sampler( self )->source;
+}
+
+/*
+ * @overload min
+ *   @!attribute [r] min
+ *   Minimum result that can be sampled
+ *   @return [Integer]
+ */
+VALUE sampler_min( VALUE self ) {
+  return INT2NUM( get_alias_sampler( self )->offset );
+}
+
+/*
+ * @overload max
+ *   @!attribute [r] max
+ *   Maximum result that can be sampled
+ *   @return [Integer]
+ */
+VALUE sampler_max( VALUE self ) {
+  AliasSampler *as = get_alias_sampler( self );
+  return INT2NUM( as->offset + ( as->slots - 1 ) * as->stride );
+}
+
+/*
+ * @overload sample(n, prng = nil)
+ *   Draws results directly from the distribution. Each draw takes constant time, no matter how
+ *   complex the dice that created the distribution were.
+ *   @param [Integer] n Number of results to draw
+ *   @param [Integer,#rand,nil] prng An Integer seed for the native generator, an object that
+ *     supports rand(Integer), or nil to seed from Ruby's built-in #rand()
+ *   @return [Array<Integer>] n results
+ */
+VALUE sampler_sample( int argc, VALUE* argv, VALUE self ) {
+  VALUE num, prng, results;
+  SampleSource src;
+  long i, n;
+  AliasSampler *as = get_alias_sampler( self );
+
+  rb_scan_args( argc, argv, "11", &num, &prng );
+  n = sample_count( num );
+  init_sample_source( &src, prng, as->slots );
+
+  results = rb_ary_new_capa( n );
+  for ( i = 0; i < n; i++ ) {
+    rb_ary_push( results, INT2NUM( as_draw( as, next_uniform( &src ) ) ) );
+  }
+  return results;
+}
+
+/*
+ * @overload histogram(n, prng = nil)
+ *   Draws results directly from the distribution, and counts them. No Ruby objects are created
+ *   per draw, so this is the cheapest way to simulate large numbers of rolls.
+ *   @param [Integer] n Number of results to draw
+ *   @param [Integer,#rand,nil] prng An Integer seed for the native generator, an object that
+ *     supports rand(Integer), or nil to seed from Ruby's built-in #rand()
+ *   @return [Hash] Each key is a result that was drawn at least once, and value is the count
+ */
+VALUE sampler_histogram( int argc, VALUE* argv, VALUE self ) {
+  VALUE num, prng, h;
+  SampleSource src;
+  long i, n;
+  long *counts;
+  AliasSampler *as = get_alias_sampler( self );
+
+  rb_scan_args( argc, argv, "11", &num, &prng );
+  n = sample_count( num );
+  init_sample_source( &src, prng, as->slots );
+
+  counts = ZALLOC_N( long, as->slots );
+  for ( i = 0; i < n; i++ ) {
+    counts[ ( as_draw( as, next_uniform( &src ) ) - as->offset ) / as->stride ]++;
+  }
+
+  h = rb_hash_new();
+  for ( i = 0; i < as->slots; i++ ) {
+    if ( counts[i] > 0 ) {
+      rb_hash_aset( h, INT2NUM( as->offset + i * as->stride ), LONG2NUM( counts[i] ) );
+    }
+  }
+  xfree( counts );
+  return h;
+}
+
+/*
+ * Creates an alias-table sampler for drawing results directly from this distribution.
+ * @return [GamesDice::Probabilities::Sampler]
+ */
+VALUE probabilities_sampler( VALUE self ) {
+  return rb_class_new_instance( 1, &self, Sampler );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Setup Probabilities::Sampler class for Ruby interpretter
+//
+
+void init_sampler_class() {
+  Sampler = rb_define_class_under( Probabilities, "Sampler", rb_cObject );
+  rb_define_alloc_func( Sampler, as_alloc );
+  rb_define_method( Sampler, "initialize", sampler_initialize, 1 );
+  rb_define_method( Sampler, "probabilities", sampler_probabilities, 0 );
+  rb_define_method( Sampler, "min", sampler_min, 0 );
+  rb_define_method( Sampler, "max", sampler_max, 0 );
+  rb_define_method( Sampler, "sample", sampler_sample, -1 );
+  rb_define_method( Sampler, "histogram", sampler_histogram, -1 );
+  rb_define_method( Probabilities, "sampler", probabilities_sampler, 0 );
+  return;
+}
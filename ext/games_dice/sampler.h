@@ -0,0 +1,32 @@
+// ext/games_dice/sampler.h
+
+// definitions for Probabilities::Sampler class
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <ruby.h>
+#include <stdint.h>
+#include "probabilities.h"
+
+void init_sampler_class();
+
+// Walker/Vose alias table. Each column i is either kept (result offset + i) with probability
+// keep[i], or swapped for its alias (result offset + alias[i]), with results stride apart.
+typedef struct _as {
+    int offset;
+    int stride;
+    int slots;
+    double *keep;
+    int *alias;
+    VALUE source;
+  } AliasSampler;
+
+// xoshiro256** state, seeded via splitmix64
+typedef struct _rs {
+    uint64_t s[4];
+  } SamplerRNG;
+
+int as_draw( AliasSampler *as, double u );
+
+#endif
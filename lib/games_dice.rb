@@ -12,6 +12,7 @@ require 'games_dice/dice'
 require 'games_dice/parser'
 require 'games_dice/games_dice'
 require 'games_dice/marshal'
+require 'games_dice/interning'
 
 # GamesDice is a library for simulating dice combinations used in dice and board games.
 module GamesDice
@@ -51,6 +51,7 @@ module GamesDice
                     else
                       GamesDice::Die.new(@sides, options[:prng])
                     end
+      init_roll_buffers
     end
 
     # Name to help identify bunch
@@ -105,9 +106,9 @@ module GamesDice
     # allowing inspection of how the result was obtained.
     # @return [Array<GamesDice::DieResult>, nil] Sequence of GamesDice::DieResult objects.
     def result_details
-      return nil unless @raw_result_details
+      return nil unless @result
 
-      @raw_result_details.map { |r| r.is_a?(Integer) ? GamesDice::DieResult.new(r) : r }
+      @result_details ||= build_result_details
     end
 
     # @!attribute [r] min
@@ -133,27 +134,40 @@ module GamesDice
     def probabilities
       return @probabilities if @probabilities
 
-      @probabilities = if @keep_mode && @ndice > @keep_number
-                         @single_die.probabilities.repeat_n_sum_k(@ndice, @keep_number, @keep_mode)
-                       else
-                         @single_die.probabilities.repeat_sum(@ndice)
-                       end
+      probs = if @keep_mode && @ndice > @keep_number
+                @single_die.probabilities.repeat_n_sum_k(@ndice, @keep_number, @keep_mode)
+              else
+                @single_die.probabilities.repeat_sum(@ndice)
+              end
+
+      @probabilities = GamesDice::Probabilities.canonical(probs)
+    end
 
-      @probabilities
+    # Calculates the joint distribution of totals shown on the dice (before any map rules) and results
+    # (after map rules) for the bunch. This is not supported when only some of the dice are kept.
+    # @return [GamesDice::JointProbabilities] Joint distribution of bunch total and mapped result.
+    def joint_probabilities
+      return @joint_probabilities if @joint_probabilities
+      raise 'Cannot calculate joint probabilities with a keep mode' if @keep_mode && @ndice > @keep_number
+
+      single = if @single_die.is_a?(GamesDice::ComplexDie)
+                 @single_die.joint_probabilities
+               else
+                 GamesDice::JointProbabilities.from_h(@single_die.probabilities.to_h.to_h { |v, p| [[v, v], p] })
+               end
+      @joint_probabilities = single.repeat_sum(@ndice)
     end
 
-    # Simulates rolling the bunch of identical dice
+    # Simulates rolling the bunch of identical dice. Only the values rolled are stored, and
+    # #result_details and #explain_result are built from them when first asked for.
     # @return [Integer] Sum of all rolled dice, or sum of all keepers
     def roll
       generate_raw_results
-      return @result if !@keep_mode || @keep_number.to_i >= @ndice
-
-      use_dice = case @keep_mode
-                 when :keep_best then @raw_result_details.sort[-@keep_number..]
-                 when :keep_worst then @raw_result_details.sort[0..(@keep_number - 1)]
-                 end
-
-      @result = use_dice.inject(0) { |so_far, die_result| so_far + die_result }
+      @result = if !@keep_mode || @keep_number >= @ndice
+                  @die_values.sum
+                else
+                  sum_of_keepers
+                end
     end
 
     # @!attribute [r] explain_result
@@ -171,13 +185,40 @@ module GamesDice
 
     private
 
+    # Values rolled on the underlying die go into @rolls, and the value of each die in the bunch into
+    # @die_values. These are the same buffer unless re-roll or map rules apply. Both are re-used by
+    # every roll.
+    def init_roll_buffers
+      @rolls = []
+      @die_values = @single_die.is_a?(GamesDice::ComplexDie) ? [] : @rolls
+    end
+
     def generate_raw_results
-      @result = 0
-      @raw_result_details = []
+      @result_details = nil
+      @rolls.clear
+      @die_values.clear
+      if @single_die.is_a?(GamesDice::ComplexDie)
+        @ndice.times { @die_values << @single_die.roll_into(@rolls) }
+      else
+        @ndice.times { @rolls << @single_die.roll }
+      end
+    end
+
+    # Partial selection of the best or worst @keep_number values, avoiding a full sort
+    def sum_of_keepers
+      best = @keep_mode == :keep_best
+      return best ? @die_values.max : @die_values.min if @keep_number == 1
+
+      (best ? @die_values.max(@keep_number) : @die_values.min(@keep_number)).sum
+    end
+
+    def build_result_details
+      return @rolls.map { |r| GamesDice::DieResult.new(r) } unless @single_die.is_a?(GamesDice::ComplexDie)
 
-      @ndice.times do
-        @result += @single_die.roll
-        @raw_result_details << @single_die.result
+      next_roll = 0
+      Array.new(@ndice) do
+        die_result, next_roll = @single_die.result_from_rolls(@rolls, next_roll)
+        die_result
       end
     end
 
@@ -111,17 +111,47 @@ module GamesDice
     # 1e-9 at worst.
     # @return [GamesDice::Probabilities] Probability distribution of die.
     def probabilities
-      @probabilities ||= calculate_probabilities
+      @probabilities ||= GamesDice::Probabilities.canonical(calculate_probabilities)
+    end
+
+    # Calculates the joint probability distribution of the total rolled (after re-rolls, but before any
+    # map rules) and the mapped result. This keeps the correlation between, for example, the number of
+    # successes and the total shown on the dice. The same limits apply as for #probabilities.
+    # @return [GamesDice::JointProbabilities] Joint distribution of die total and mapped result.
+    def joint_probabilities
+      @joint_probabilities ||= calculate_joint_probabilities
     end
 
     # Simulates rolling the die
     # @param [Symbol] reason Assign a reason for rolling the first die.
     # @return [GamesDice::DieResult] Detailed results from rolling the die, including resolution of rules.
     def roll(reason = :basic)
-      @result = GamesDice::DieResult.new(@basic_die.roll, reason)
-      roll_apply_rerolls
-      roll_apply_maps
-      @result
+      @result = build_result(reason) { @basic_die.roll }
+    end
+
+    # Simulates rolling the die, and appends each value rolled on #basic_die to a buffer, from which
+    # #result_from_rolls can rebuild the result later. Re-rolls and maps are resolved on the values
+    # alone, so unlike #roll this builds no GamesDice::DieResult, and does not change #result.
+    # @param [Array<Integer>] rolls Buffer of values rolled
+    # @return [Integer] Value of the die, after any re-rolls and maps
+    def roll_into(rolls)
+      total = (rolls << @basic_die.roll).last
+      total = reroll_into(rolls, total) if @rerolls
+      @maps ? map_value(total) : total
+    end
+
+    # Rebuilds a result from values rolled on #basic_die, as recorded by #roll_into. Re-roll rules are
+    # applied to the recorded values in the same way as to new rolls.
+    # @param [Array<Integer>] rolls Buffer of values rolled
+    # @param [Integer] start Index in rolls of first value for this die
+    # @return [Array(GamesDice::DieResult, Integer)] The result, and index in rolls of the first value not used
+    def result_from_rolls(rolls, start = 0)
+      i = start
+      result = build_result(:basic) do
+        i += 1
+        rolls[i - 1]
+      end
+      [result, i]
     end
 
     private
@@ -19,6 +19,17 @@ module GamesDice
         end
       end
 
+      def calculate_joint_probabilities
+        prob_hash = {}
+        totals_hash = @rerolls ? recursive_probabilities : @basic_die.probabilities.to_h
+        totals_hash.each do |v, p|
+          key = [v, @maps ? calc_maps(v).first : v]
+          prob_hash[key] ||= 0.0
+          prob_hash[key] += p
+        end
+        GamesDice::JointProbabilities.from_h(prob_hash)
+      end
+
       def prob_hash_with_rerolls_and_maps
         prob_hash = {}
         reroll_probs = recursive_probabilities
@@ -129,50 +140,104 @@ module GamesDice
     module RollHelpers
       private
 
-      def roll_apply_rerolls
+      # Builds a result from values of the basic die supplied by the block, which is called once for
+      # each roll, so the same code simulates new rolls and replays recorded ones
+      def build_result(reason, &next_roll)
+        result = GamesDice::DieResult.new(next_roll.call, reason)
+        apply_rerolls(result, next_roll)
+        apply_maps(result)
+        result
+      end
+
+      def apply_rerolls(result, next_roll)
         return unless @rerolls
 
         subtracting = false
         rerolls_remaining = @rerolls.map(&:limit)
 
-        rerolls_loop(subtracting, rerolls_remaining)
+        rerolls_loop(result, subtracting, rerolls_remaining, next_roll)
       end
 
-      def rerolls_loop(subtracting, rerolls_remaining)
+      def rerolls_loop(result, subtracting, rerolls_remaining, next_roll)
         loop do
-          rule_idx = find_matching_reroll_rule(@basic_die.result, @result.rolls.length, rerolls_remaining)
+          rule_idx = find_matching_reroll_rule(result.rolls.last, result.rolls.length, rerolls_remaining)
           break unless rule_idx
 
           rule = @rerolls[rule_idx]
           rerolls_remaining[rule_idx] -= 1
           subtracting = true if rule.type == :reroll_subtract
-          roll_apply_reroll_rule rule, subtracting
+          apply_reroll_rule result, rule, subtracting, next_roll
         end
       end
 
-      def roll_apply_reroll_rule(rule, is_subtracting)
-        # Apply the rule (note reversal for additions, after a subtract)
-        if is_subtracting && rule.type == :reroll_add
-          @result.add_roll(@basic_die.roll, :reroll_subtract)
-        else
-          @result.add_roll(@basic_die.roll, rule.type)
-        end
+      def apply_reroll_rule(result, rule, is_subtracting, next_roll)
+        result.add_roll(next_roll.call, reroll_reason(rule, is_subtracting))
+      end
+
+      # Apply the rule (note reversal for additions, after a subtract)
+      def reroll_reason(rule, is_subtracting)
+        is_subtracting && rule.type == :reroll_add ? :reroll_subtract : rule.type
       end
 
-      # Find which rule, if any, is being triggered
+      # Find which rule, if any, is being triggered. This is a plain loop because returning from
+      # inside a block allocates, and it is called for every roll.
       def find_matching_reroll_rule(check_value, num_rolls, rerolls_remaining)
-        @rerolls.zip(rerolls_remaining).find_index do |rule, remaining|
-          next if rule.type == :reroll_subtract && num_rolls > 1
+        i = 0
+        while i < @rerolls.length
+          rule = @rerolls[i]
+          unless rule.type == :reroll_subtract && num_rolls > 1
+            return i if rerolls_remaining[i].positive? && rule.applies?(check_value)
+          end
+          i += 1
+        end
+        nil
+      end
+
+      # Same rules as #apply_rerolls, but on plain values, so that rolls allocate no objects. The
+      # counts of re-rolls left are kept in a buffer that is re-used by every roll.
+      def reroll_into(rolls, total)
+        first = rolls.length - 1
+        subtracting = false
+        remaining = (@rerolls_remaining ||= Array.new(@rerolls.length))
+        @rerolls.each_index { |i| remaining[i] = @rerolls[i].limit }
+
+        while (rule_idx = find_matching_reroll_rule(rolls.last, rolls.length - first, remaining))
+          rule = @rerolls[rule_idx]
+          remaining[rule_idx] -= 1
+          subtracting = true if rule.type == :reroll_subtract
+          total = total_after_roll(total, (rolls << @basic_die.roll).last, reroll_reason(rule, subtracting))
+        end
+        total
+      end
 
-          remaining.positive? && rule.applies?(check_value)
+      # Matches GamesDice::DieResult#add_roll
+      def total_after_roll(total, roll, reason)
+        case reason
+        when :reroll_add then total + roll
+        when :reroll_subtract then total - roll
+        when :reroll_use_best then [total, roll].max
+        when :reroll_use_worst then [total, roll].min
+        else roll
         end
       end
 
-      def roll_apply_maps
+      def apply_maps(result)
         return unless @maps
 
-        m, n = calc_maps(@result.value)
-        @result.apply_map(m, n)
+        m, n = calc_maps(result.value)
+        result.apply_map(m, n)
+      end
+
+      # Mapped value alone, as #calc_maps without the name, looping as #find_matching_reroll_rule
+      def map_value(original_value)
+        i = 0
+        while i < @maps.length
+          mapped = @maps[i].map_from(original_value)
+          return mapped if mapped
+
+          i += 1
+        end
+        0
       end
 
       def calc_maps(original_value)
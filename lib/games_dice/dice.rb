@@ -69,7 +69,9 @@ module GamesDice
     # Simulates rolling dice
     # @return [Integer] Sum of all rolled dice
     def roll
-      @result = @offset + bunches_weighted_sum(:roll)
+      total = @offset
+      @bunches.size.times { |i| total += @bunch_multipliers[i] * @bunches[i].roll }
+      @result = total
     end
 
     # @!attribute [r] min
@@ -100,10 +102,12 @@ module GamesDice
     def probabilities
       return @probabilities if @probabilities
 
-      @bunch_multipliers.zip(@bunches).inject(GamesDice::Probabilities.new([1.0], @offset)) do |probs, mb|
+      probs = @bunch_multipliers.zip(@bunches).inject(GamesDice::Probabilities.new([1.0], @offset)) do |so_far, mb|
         m, b = mb
-        GamesDice::Probabilities.add_distributions_mult(1, probs, m, b.probabilities)
+        GamesDice::Probabilities.add_distributions_mult(1, so_far, m, b.probabilities)
       end
+
+      @probabilities = GamesDice::Probabilities.canonical(probs)
     end
 
     # @!attribute [r] explain_result
@@ -58,7 +58,7 @@ module GamesDice
     # Calculates probability distribution for this die.
     # @return [GamesDice::Probabilities] probability distribution of the die
     def probabilities
-      @probabilities ||= GamesDice::Probabilities.for_fair_die(@sides)
+      @probabilities ||= GamesDice::Probabilities.canonical(GamesDice::Probabilities.for_fair_die(@sides))
     end
 
     # Simulates rolling the die
@@ -0,0 +1,57 @@
+# frozen_string_literal: true
+
+module GamesDice
+  class Probabilities
+    # Distributions by content hash. Both are weak, so entries go when the distribution is
+    # collected. Integer keys need Ruby 2.7 or later.
+    @intern_table = ObjectSpace::WeakMap.new if RUBY_VERSION >= '2.7'
+
+    # @!visibility private
+    # Held while looking up or adding to the table, so threads interning equal distributions at the
+    # same time get the same one
+    INTERN_LOCK = Mutex.new
+
+    class << self
+      # Whether Die, ComplexDie, Bunch and Dice objects intern their probabilities, so that objects
+      # describing the same dice share one frozen distribution. Off by default.
+      # @return [Boolean]
+      def interning?
+        @interning ? true : false
+      end
+
+      # Turns interning of probabilities calculated by dice objects on or off. Probabilities that
+      # have already been calculated are not changed.
+      # @param [Boolean] flag
+      def interning=(flag)
+        @interning = flag ? true : false
+      end
+
+      # Canonical frozen distribution with the same content as probs, see #eql?. The first
+      # distribution interned with some content becomes canonical, and stays so while anything else
+      # refers to it. When probs is not frozen, a frozen copy is interned in its place. Before Ruby
+      # 2.7 nothing is shared, and this only returns a frozen distribution equal to probs.
+      # @param [GamesDice::Probabilities] probs Distribution to intern
+      # @return [GamesDice::Probabilities]
+      def intern(probs)
+        raise TypeError, "Expected a Probabilities object, but got #{probs.class}" unless probs.is_a?(self)
+
+        key = probs.hash
+        INTERN_LOCK.synchronize do
+          found = @intern_table && @intern_table[key]
+          return found if found.eql?(probs)
+
+          probs = probs.dup.freeze unless probs.frozen?
+          # On the rare hash collision, the distribution already in the table keeps its place
+          @intern_table[key] = probs if @intern_table && !found
+        end
+        probs
+      end
+
+      # @!visibility private
+      # Used by dice objects for their probabilities, interned if #interning? is set
+      def canonical(probs)
+        interning? ? intern(probs) : probs
+      end
+    end
+  end
+end
@@ -253,6 +253,14 @@ describe GamesDice::Bunch do
         end
       end
 
+      it 'should give details of every die rolled' do
+        expect(bunch.result_details).to be_nil
+        bunch.roll
+        bunch.roll
+        expect(bunch.result_details.map(&:explain_value)).to eql ['3', '7', '7', '6', '[10+7] 17']
+        expect(bunch.result_details).to be bunch.result_details
+      end
+
       it 'should calculate correct min, max = 2, > 100' do
         expect(bunch.min).to eql 2
         expect(bunch.max).to be > 100
@@ -396,4 +404,23 @@ describe GamesDice::Bunch do
       end
     end
   end
+
+  describe '#roll' do
+    it 'should not allocate objects when rolling basic dice' do
+      bunch = GamesDice::Bunch.new(sides: 20, ndice: 2, keep_mode: :keep_best, keep_number: 1)
+      bunch.roll
+      before = GC.stat(:total_allocated_objects)
+      1000.times { bunch.roll }
+      expect(GC.stat(:total_allocated_objects) - before).to be < 10
+    end
+
+    it 'should not allocate objects when rolling dice with re-rolls and maps' do
+      bunch = GamesDice::Bunch.new(sides: 10, ndice: 10, rerolls: [[10, :<=, :reroll_add], [1, :>=, :reroll_subtract]],
+                                   maps: [[8, :<=, 1]])
+      bunch.roll
+      before = GC.stat(:total_allocated_objects)
+      1000.times { bunch.roll }
+      expect(GC.stat(:total_allocated_objects) - before).to be < 10
+    end
+  end
 end
@@ -310,5 +310,19 @@ describe GamesDice::ComplexDie do
         expect(@die.explain_result).to eql expected
       end
     end
+
+    it 'should rebuild results from recorded rolls' do
+      rolls = []
+      values = Array.new(4) { @die.roll_into(rolls) }
+      expect(values).to eql [0, 1, 0, 0]
+      expect(rolls).to eql [5, 6, 4, 6, 2, 5]
+
+      next_roll = 0
+      ['5', '[6+4] 10 Success', '[6+2] 8', '5'].each do |expected|
+        result, next_roll = @die.result_from_rolls(rolls, next_roll)
+        expect(result.explain_value).to eql expected
+      end
+      expect(next_roll).to eql 6
+    end
   end
 end
@@ -0,0 +1,117 @@
+# frozen_string_literal: true
+
+require 'helpers'
+
+describe GamesDice::JointProbabilities do
+  let(:d10_successes) { GamesDice::ComplexDie.new(10, maps: [[8, :<=, 1, 'Success']]) }
+  let(:jpd10) { d10_successes.joint_probabilities }
+
+  describe '#from_h' do
+    it 'should create a joint distribution from a hash of [total, mapped] pairs' do
+      jpd = GamesDice::JointProbabilities.from_h({ [1, 0] => 0.5, [2, 1] => 0.25, [3, 1] => 0.25 })
+      expect(jpd).to be_a GamesDice::JointProbabilities
+      expect(jpd.total_min).to eql 1
+      expect(jpd.total_max).to eql 3
+      expect(jpd.mapped_min).to eql 0
+      expect(jpd.mapped_max).to eql 1
+      expect(jpd.p_eql(2, 1)).to be_within(1e-15).of 0.25
+      expect(jpd.p_eql(2, 0)).to eql 0.0
+      expect(jpd.p_eql(20, 0)).to eql 0.0
+    end
+
+    it 'should raise an error if params are unexpected' do
+      expect(-> { GamesDice::JointProbabilities.from_h('x') }).to raise_error TypeError
+      expect(-> { GamesDice::JointProbabilities.from_h({ 1 => 1.0 }) }).to raise_error TypeError
+      expect(-> { GamesDice::JointProbabilities.from_h({ [1] => 1.0 }) }).to raise_error ArgumentError
+      expect(-> { GamesDice::JointProbabilities.from_h({ [1, 0] => 0.5 }) }).to raise_error ArgumentError
+      bad = { [1, 0] => 1.5, [2, 0] => -0.5 }
+      expect(-> { GamesDice::JointProbabilities.from_h(bad) }).to raise_error ArgumentError
+    end
+  end
+
+  describe 'GamesDice::ComplexDie#joint_probabilities' do
+    it 'should pair each face with its mapped value' do
+      h = jpd10.to_h
+      expect(h.keys.sort).to eql [[1, 0], [2, 0], [3, 0], [4, 0], [5, 0], [6, 0], [7, 0], [8, 1], [9, 1], [10, 1]]
+      h.each_value { |p| expect(p).to be_within(1e-15).of 0.1 }
+    end
+
+    it 'should include totals from rerolls' do
+      die = GamesDice::ComplexDie.new(6, rerolls: [[6, :<=, :reroll_add, 1]], maps: [[5, :<=, 1, 'Success']])
+      jpd = die.joint_probabilities
+      expect(jpd.total_max).to eql 12
+      expect(jpd.p_eql(7, 1)).to be_within(1e-15).of 1.0 / 36
+      expect(jpd.p_eql(5, 1)).to be_within(1e-15).of 1.0 / 6
+      expect(jpd.mapped_probabilities.to_h).to be_valid_distribution
+    end
+  end
+
+  describe '#repeat_sum' do
+    let(:jpd6d10) { jpd10.repeat_sum(6) }
+
+    it 'should have marginals that match one-dimensional calculations' do
+      totals = GamesDice::Probabilities.for_fair_die(10).repeat_sum(6)
+      successes = d10_successes.probabilities.repeat_sum(6)
+      jpd6d10.total_probabilities.each { |t, p| expect(p).to be_within(1e-12).of totals.p_eql(t) }
+      jpd6d10.mapped_probabilities.each { |m, p| expect(p).to be_within(1e-12).of successes.p_eql(m) }
+      expect(jpd6d10.to_h.values.inject(:+)).to be_within(1e-12).of 1.0
+    end
+
+    it 'should keep the correlation between total and mapped result' do
+      # Six successes means a total of at least 48
+      expect(jpd6d10.p_eql(47, 6)).to eql 0.0
+      expect(jpd6d10.p_eql(48, 6)).to be_within(1e-15).of 1e-6
+      expect(jpd6d10.p_eql(60, 6)).to be_within(1e-15).of 1e-6
+      expect(jpd6d10.given_mapped(6).min).to eql 48
+      expect(jpd6d10.given_total(60).to_h).to eql({ 6 => 1.0 })
+      expect(jpd6d10.given_total(7).p_eql(0)).to be_within(1e-15).of 1.0
+    end
+
+    it 'should give conditional distributions that match direct calculation' do
+      given = jpd6d10.given_mapped(2)
+      expected = jpd6d10.to_h.select { |(_t, m), _p| m == 2 }
+      total = expected.values.inject(:+)
+      expected.each { |(t, _m), p| expect(given.p_eql(t)).to be_within(1e-12).of p / total }
+      expect(given.to_h).to be_valid_distribution
+    end
+
+    it 'should raise an error if distribution would be too large' do
+      expect(-> { jpd10.repeat_sum(0) }).to raise_error RuntimeError
+      expect(-> { jpd10.repeat_sum(200_000) }).to raise_error(RuntimeError, /Too many probability slots/)
+    end
+  end
+
+  describe '#add_distributions' do
+    it 'should combine two joint distributions' do
+      jpd = GamesDice::JointProbabilities.add_distributions(jpd10, jpd10)
+      expect(jpd.to_h).to eql jpd10.repeat_sum(2).to_h
+      expect(-> { GamesDice::JointProbabilities.add_distributions(jpd10, 6) }).to raise_error TypeError
+      big = GamesDice::JointProbabilities.from_h({ [0, 0] => 0.5, [600, 600] => 0.5 })
+      expect(-> { GamesDice::JointProbabilities.add_distributions(big, big) }).to raise_error ArgumentError
+    end
+  end
+
+  describe '#given_total and #given_mapped' do
+    it 'should raise an error when the condition cannot happen' do
+      expect(-> { jpd10.given_total(11) }).to raise_error RuntimeError
+      expect(-> { jpd10.given_mapped(-1) }).to raise_error RuntimeError
+    end
+  end
+
+  describe 'GamesDice::Bunch#joint_probabilities' do
+    it 'should calculate joint distribution for a bunch with maps' do
+      bunch = GamesDice::Bunch.new(ndice: 6, sides: 10, maps: [[8, :<=, 1, 'Success']])
+      expect(bunch.joint_probabilities.to_h).to eql jpd10.repeat_sum(6).to_h
+    end
+
+    it 'should calculate joint distribution for a bunch of simple dice' do
+      bunch = GamesDice::Bunch.new(ndice: 2, sides: 6)
+      expect(bunch.joint_probabilities.p_eql(7, 7)).to be_within(1e-15).of 1.0 / 6
+    end
+
+    it 'should raise an error for bunches with a keep mode' do
+      bunch = GamesDice::Bunch.new(ndice: 4, sides: 6, keep_mode: :keep_best, keep_number: 3)
+      expect(-> { bunch.joint_probabilities }).to raise_error RuntimeError
+    end
+  end
+end
@@ -0,0 +1,148 @@
+# frozen_string_literal: true
+
+require 'helpers'
+require 'tmpdir'
+
+describe GamesDice::MappedProbabilities do
+  let(:d6) { GamesDice::Probabilities.for_fair_die(6) }
+  let(:d100) { GamesDice::Probabilities.for_fair_die(100) }
+
+  describe 'class methods' do
+    describe '#for_fair_die' do
+      it 'should allow more sides than GamesDice::Probabilities' do
+        md = GamesDice::MappedProbabilities.for_fair_die(2_000_000)
+        expect(md.min).to eql 1
+        expect(md.max).to eql 2_000_000
+        expect(md.p_eql(1_500_000)).to be_within(1e-18).of(5.0e-7)
+        expect(md.p_le(500_000)).to be_within(1e-10).of(0.25)
+        expect(md.path).to be_nil
+      end
+
+      it 'should raise an error if number of sides is not an integer' do
+        expect(-> { GamesDice::MappedProbabilities.for_fair_die({}) }).to raise_error TypeError
+      end
+
+      it 'should raise an error if number of sides is too low' do
+        expect(-> { GamesDice::MappedProbabilities.for_fair_die(0) }).to raise_error ArgumentError
+      end
+    end
+
+    describe '#repeat_sum' do
+      it 'should match the in-memory distribution' do
+        md = GamesDice::MappedProbabilities.repeat_sum(d100, 37, nil, 16_384)
+        pd = d100.repeat_sum(37)
+        expect(md.min).to eql pd.min
+        expect(md.max).to eql pd.max
+        expect(md.expected).to be_within(1e-9).of(pd.expected)
+        [37, 500, 1868, 3000, 3700].each do |t|
+          expect(md.p_eql(t)).to be_within(1e-12).of(pd.p_eql(t))
+          expect(md.p_ge(t)).to be_within(1e-12).of(pd.p_ge(t))
+          expect(md.p_lt(t)).to be_within(1e-12).of(pd.p_lt(t))
+        end
+      end
+
+      it 'should keep the spacing of multiplied distributions' do
+        ten_d6 = GamesDice::Probabilities.add_distributions_mult(10, d6, 0, d6)
+        md = GamesDice::MappedProbabilities.repeat_sum(ten_d6, 3, nil, 16_384)
+        expect(md.p_eql(31)).to eql 0.0
+        expect(md.p_eql(30)).to be_within(1e-12).of(1.0 / 216)
+        expect(md.to_probabilities.to_h.keys.sort).to eql d6.repeat_sum(3).to_h.keys.sort.map { |k| 10 * k }
+      end
+
+      it 'should raise an error if n is too low' do
+        expect(-> { GamesDice::MappedProbabilities.repeat_sum(d6, 0) }).to raise_error RuntimeError
+      end
+
+      it 'should raise an error if memory budget is not positive' do
+        expect(-> { GamesDice::MappedProbabilities.repeat_sum(d6, 2, nil, 0) }).to raise_error ArgumentError
+      end
+
+      it 'should raise an error if distribution is not a probabilities object' do
+        expect(-> { GamesDice::MappedProbabilities.repeat_sum([1.0], 2) }).to raise_error TypeError
+      end
+    end
+
+    describe '#add_distributions' do
+      it 'should match the in-memory distribution' do
+        md = GamesDice::MappedProbabilities.add_distributions(d6, d100)
+        pd = GamesDice::Probabilities.add_distributions(d6, d100)
+        (pd.min..pd.max).each do |t|
+          expect(md.p_eql(t)).to be_within(1e-15).of(pd.p_eql(t))
+        end
+      end
+
+      it 'should calculate distributions with more than 1,000,000 results' do
+        d2 = GamesDice::Probabilities.for_fair_die(2)
+        d1m = GamesDice::MappedProbabilities.for_fair_die(1_000_000)
+        md = GamesDice::MappedProbabilities.add_distributions(d1m, d2)
+        expect(md.min).to eql 2
+        expect(md.max).to eql 1_000_002
+        expect(md.expected).to be_within(1e-6).of(500_002.0)
+        expect(md.p_eql(2)).to be_within(1e-18).of(5.0e-7)
+        expect(md.p_gt(1_000_001)).to be_within(1e-18).of(5.0e-7)
+        expect(-> { md.to_probabilities }).to raise_error(RuntimeError, /Too many probability slots/)
+      end
+
+      it 'should allow the result to replace one of the inputs' do
+        Dir.mktmpdir do |dir|
+          path = File.join(dir, '2d6.gdprob')
+          GamesDice::MappedProbabilities.repeat_sum(d6, 2, path)
+          md = GamesDice::MappedProbabilities.add_distributions(GamesDice::MappedProbabilities.open(path), d6, path)
+          expect(md.p_eql(13)).to be_within(1e-15).of 21 / 216.0
+          expect(md.expected).to be_within(1e-12).of 10.5
+          expect(GamesDice::MappedProbabilities.open(path).max).to eql 18
+          expect(Dir.children(dir)).to eql ['2d6.gdprob']
+        end
+      end
+
+      it 'should stop when the thread is interrupted' do
+        calculation = Thread.new { GamesDice::MappedProbabilities.repeat_sum(d6, 300_000, nil, 1 << 20) }
+        sleep 0.2
+        calculation.kill
+        expect(calculation.join(5)).to be calculation
+      end
+
+      it 'should raise an error if either distribution is not a probabilities object' do
+        expect(-> { GamesDice::MappedProbabilities.add_distributions(d6, nil) }).to raise_error TypeError
+        expect(-> { GamesDice::MappedProbabilities.add_distributions('d6', d6) }).to raise_error TypeError
+      end
+    end
+
+    describe '#open' do
+      it 'should read a distribution written to a file' do
+        Dir.mktmpdir do |dir|
+          path = File.join(dir, '3d6.gdprob')
+          md = GamesDice::MappedProbabilities.repeat_sum(d6, 3, path)
+          expect(md.path).to eql path
+
+          reopened = GamesDice::MappedProbabilities.open(path)
+          expect(reopened.min).to eql 3
+          expect(reopened.max).to eql 18
+          expect(reopened.to_probabilities.to_h).to eql md.to_probabilities.to_h
+        end
+      end
+
+      it 'should raise an error if the file is missing' do
+        Dir.mktmpdir do |dir|
+          expect(-> { GamesDice::MappedProbabilities.open(File.join(dir, 'none.gdprob')) }).to raise_error IOError
+        end
+      end
+
+      it 'should raise an error if the file is not a distribution' do
+        Dir.mktmpdir do |dir|
+          path = File.join(dir, 'other.gdprob')
+          File.write(path, 'not a distribution')
+          expect(-> { GamesDice::MappedProbabilities.open(path) }).to raise_error ArgumentError
+        end
+      end
+    end
+  end
+
+  describe 'limits on GamesDice::Probabilities' do
+    it 'should be unchanged' do
+      expect(-> { GamesDice::Probabilities.for_fair_die(1_000_001) }).to raise_error ArgumentError
+      d1000 = GamesDice::Probabilities.for_fair_die(1000)
+      expect(-> { d1000.repeat_sum(11_000) }).to raise_error(RuntimeError, /Too many probability slots/)
+    end
+  end
+end
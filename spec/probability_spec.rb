@@ -51,6 +51,43 @@ describe GamesDice::Probabilities do
       end
     end
 
+    describe '#for_fair_dice' do
+      it 'should match repeat_sum of a fair die' do
+        [[1, 6], [3, 6], [20, 6], [5, 20], [7, 100], [3, 1000]].each do |n, sides|
+          pd = GamesDice::Probabilities.for_fair_dice(n, sides)
+          expected = GamesDice::Probabilities.new(Array.new(sides, 1.0 / sides), 1).repeat_sum(n)
+          expect(pd.min).to eql n
+          expect(pd.max).to eql n * sides
+          expect(pd.expected).to be_within(1e-9 * n * sides).of(n * (sides + 1) / 2.0)
+          expected.each do |t, p|
+            expect(pd.p_eql(t)).to be_within(1e-13 * p).of p
+          end
+        end
+      end
+
+      it 'should keep precision in the tails' do
+        pd = GamesDice::Probabilities.for_fair_dice(30, 100)
+        expect(pd.p_eql(30)).to be_within(1e-72).of 1e-60
+        expect(pd.p_ge(2999)).to be_within(1e-72).of 31e-60
+      end
+
+      it 'should be used by repeat_sum of a fair die' do
+        d1000 = GamesDice::Probabilities.for_fair_die(1000)
+        expect(d1000.repeat_sum(50).to_h).to eql GamesDice::Probabilities.for_fair_dice(50, 1000).to_h
+        expect(-> { d1000.repeat_sum(11_000) }).to raise_error(RuntimeError, /Too many probability slots/)
+      end
+
+      it 'should raise an error if number of dice or sides is too low' do
+        expect(-> { GamesDice::Probabilities.for_fair_dice(0, 6) }).to raise_error ArgumentError
+        expect(-> { GamesDice::Probabilities.for_fair_dice(2, 0) }).to raise_error ArgumentError
+      end
+
+      it 'should raise an error if there are too many results' do
+        expect(-> { GamesDice::Probabilities.for_fair_dice(1100, 1000) })
+          .to raise_error(RuntimeError, /Too many probability slots/)
+      end
+    end
+
     describe '#add_distributions' do
       it 'should combine two distributions to create a third one' do
         d4a = GamesDice::Probabilities.new([1.0 / 4, 1.0 / 4, 1.0 / 4, 1.0 / 4], 1)
@@ -85,6 +122,49 @@ describe GamesDice::Probabilities do
       end
     end
 
+    describe '#p_greater, #p_tie and #p_compare' do
+      let(:pr3d6p2) do
+        GamesDice::Probabilities.add_distributions(GamesDice::Probabilities.for_fair_die(6).repeat_sum(3),
+                                                   GamesDice::Probabilities.new([1.0], 2))
+      end
+      let(:pr2d8) { GamesDice::Probabilities.for_fair_die(8).repeat_sum(2) }
+
+      it 'should match the distribution of differences' do
+        diff = GamesDice::Probabilities.add_distributions_mult(1, pr3d6p2, -1, pr2d8)
+        expect(GamesDice::Probabilities.p_greater(pr3d6p2, pr2d8)).to be_within(1e-12).of diff.p_gt(0)
+        expect(GamesDice::Probabilities.p_tie(pr3d6p2, pr2d8)).to be_within(1e-12).of diff.p_eql(0)
+        expect(GamesDice::Probabilities.p_greater(pr2d8, pr3d6p2)).to be_within(1e-12).of diff.p_lt(0)
+      end
+
+      it 'should handle distributions that do not overlap' do
+        pr6 = GamesDice::Probabilities.for_fair_die(6)
+        pr_high = GamesDice::Probabilities.new([0.5, 0.5], 10)
+        expect(GamesDice::Probabilities.p_greater(pr_high, pr6)).to eql 1.0
+        expect(GamesDice::Probabilities.p_greater(pr6, pr_high)).to eql 0.0
+        expect(GamesDice::Probabilities.p_tie(pr6, pr_high)).to eql 0.0
+      end
+
+      it 'should compare against many opponents at once' do
+        opponents = [pr2d8, GamesDice::Probabilities.for_fair_die(20), pr3d6p2]
+        results = GamesDice::Probabilities.p_compare(pr3d6p2, opponents)
+        expect(results.count).to eql 3
+        results.zip(opponents).each do |(p_greater, p_tie, p_less), pr|
+          expect(p_greater).to be_within(1e-15).of GamesDice::Probabilities.p_greater(pr3d6p2, pr)
+          expect(p_tie).to be_within(1e-15).of GamesDice::Probabilities.p_tie(pr3d6p2, pr)
+          expect(p_less).to be_within(1e-15).of GamesDice::Probabilities.p_greater(pr, pr3d6p2)
+          expect(p_greater + p_tie + p_less).to be_within(1e-12).of 1.0
+        end
+        expect(results[2][0]).to be_within(1e-15).of results[2][2]
+      end
+
+      it 'should raise an error if params are unexpected' do
+        expect(-> { GamesDice::Probabilities.p_greater(pr2d8, 6) }).to raise_error TypeError
+        expect(-> { GamesDice::Probabilities.p_tie('x', pr2d8) }).to raise_error TypeError
+        expect(-> { GamesDice::Probabilities.p_compare(pr2d8, pr2d8) }).to raise_error TypeError
+        expect(-> { GamesDice::Probabilities.p_compare(pr2d8, [pr2d8, 6]) }).to raise_error TypeError
+      end
+    end
+
     describe '#add_distributions_mult' do
       it 'should combine two multiplied distributions to create a third one' do
         d4a = GamesDice::Probabilities.new([1.0 / 4, 1.0 / 4, 1.0 / 4, 1.0 / 4], 1)
@@ -122,6 +202,35 @@ describe GamesDice::Probabilities do
         expect(h[12]).to be_within(1e-9).of 0.3 * 0.2
       end
 
+      it "should store '10 x 1d6' compactly and combine it with other distributions" do
+        d6 = GamesDice::Probabilities.for_fair_die(6)
+        d100 = GamesDice::Probabilities.for_fair_die(100)
+        tens = GamesDice::Probabilities.add_distributions_mult(10, d6, 0, d6)
+        expect(tens.to_h.keys).to eql [10, 20, 30, 40, 50, 60]
+        expect(tens.p_le(35)).to be_within(1e-10).of 0.5
+        expect(tens.p_ge(35)).to be_within(1e-10).of 0.5
+        expect(tens.given_ge(35).to_h.keys).to eql [40, 50, 60]
+        expect(tens.given_ge(35).p_eql(50)).to be_within(1e-10).of 1.0 / 3
+        expect(tens.repeat_sum(2).p_eql(70)).to be_within(1e-10).of 6.0 / 36
+        expect(tens.repeat_n_sum_k(3, 2).max).to eql 120
+        expect(tens.sampler.sample(100, 1).all? { |r| (r % 10).zero? }).to be true
+
+        pr = GamesDice::Probabilities.add_distributions(tens, d100)
+        expect(pr.min).to eql 11
+        expect(pr.max).to eql 160
+        expect(pr.p_eql(11)).to be_within(1e-12).of 1.0 / 600
+        expect(pr.p_eql(60)).to be_within(1e-12).of 5.0 / 600
+        expect(pr.to_h).to be_valid_distribution
+      end
+
+      it 'should use memory in proportion to the number of possible results' do
+        require 'objspace'
+        d6 = GamesDice::Probabilities.for_fair_die(6)
+        huge = GamesDice::Probabilities.add_distributions_mult(100_000, d6, 0, d6)
+        expect(huge.max).to eql 600_000
+        expect(ObjectSpace.memsize_of(huge)).to be < 1000
+      end
+
       it 'should raise an error if passed incorrect objects for distributions' do
         d10 = GamesDice::Probabilities.for_fair_die(10)
         expect(-> { GamesDice::Probabilities.add_distributions_mult(1, '', -1, 6) }).to raise_error TypeError
@@ -157,7 +266,72 @@ describe GamesDice::Probabilities do
       end
 
       it 'should raise an ArgumentError when results are spread very far apart' do
-        expect(-> { GamesDice::Probabilities.from_h({ 0 => 0.5, 2_000_000 => 0.5 }) }).to raise_error ArgumentError
+        h = { 0 => 0.5, 1 => 0.25, 2_000_000 => 0.25 }
+        expect(-> { GamesDice::Probabilities.from_h(h) }).to raise_error ArgumentError
+      end
+
+      it 'should store evenly spaced results compactly' do
+        pr = GamesDice::Probabilities.from_h({ 0 => 0.5, 2_000_000 => 0.5 })
+        expect(pr.max).to eql 2_000_000
+        expect(pr.p_le(1_999_999)).to be_within(1e-10).of 0.5
+        pr = GamesDice::Probabilities.from_h({ -5 => 0.25, 10 => 0.5, 25 => 0.25 })
+        expect(pr.to_h).to eql({ -5 => 0.25, 10 => 0.5, 25 => 0.25 })
+        expect(pr.p_eql(0)).to eql 0.0
+        expect(pr.p_gt(9)).to be_within(1e-10).of 0.75
+        expect(pr.expected).to be_within(1e-10).of 10.0
+      end
+    end
+
+    describe '#fair_dice_p_eql, #fair_dice_p_le, #fair_dice_p_lt, #fair_dice_p_ge, #fair_dice_p_gt' do
+      it 'should match the full distribution for small pools' do
+        [[1, 6], [3, 6], [10, 10], [7, 1], [30, 20]].each do |ndice, sides|
+          pr = GamesDice::Probabilities.for_fair_die(sides).repeat_sum(ndice)
+          ((ndice - 1)..((ndice * sides) + 1)).each do |t|
+            expect(GamesDice::Probabilities.fair_dice_p_eql(ndice, sides, t)).to be_within(1e-12).of pr.p_eql(t)
+            expect(GamesDice::Probabilities.fair_dice_p_le(ndice, sides, t)).to be_within(1e-12).of pr.p_le(t)
+            expect(GamesDice::Probabilities.fair_dice_p_lt(ndice, sides, t)).to be_within(1e-12).of pr.p_lt(t)
+            expect(GamesDice::Probabilities.fair_dice_p_ge(ndice, sides, t)).to be_within(1e-12).of pr.p_ge(t)
+            expect(GamesDice::Probabilities.fair_dice_p_gt(ndice, sides, t)).to be_within(1e-12).of pr.p_gt(t)
+          end
+        end
+      end
+
+      it 'should keep relative accuracy in the tails' do
+        pr = GamesDice::Probabilities.for_fair_die(6).repeat_sum(1000)
+        [1200, 2000, 2500, 3000, 3500].each do |t|
+          expected = pr.p_le(t)
+          expect(GamesDice::Probabilities.fair_dice_p_le(1000, 6, t)).to be_within(expected * 1e-9).of expected
+          expected = pr.p_eql(t)
+          expect(GamesDice::Probabilities.fair_dice_p_eql(1000, 6, t)).to be_within(expected * 1e-9).of expected
+        end
+        expect(GamesDice::Probabilities.fair_dice_p_ge(10, 10, 95)).to be_within(1e-20).of 3003.0 / 1e10
+      end
+
+      it 'should apply a multiplier to the total' do
+        pr4d6 = GamesDice::Probabilities.for_fair_die(6).repeat_sum(4)
+        [-3, 2].each do |m|
+          pr = GamesDice::Probabilities.add_distributions_mult(1, GamesDice::Probabilities.new([1.0], 0), m, pr4d6)
+          ((pr.min - 2)..(pr.max + 2)).each do |t|
+            expect(GamesDice::Probabilities.fair_dice_p_eql(4, 6, t, m)).to be_within(1e-12).of pr.p_eql(t)
+            expect(GamesDice::Probabilities.fair_dice_p_le(4, 6, t, m)).to be_within(1e-12).of pr.p_le(t)
+            expect(GamesDice::Probabilities.fair_dice_p_gt(4, 6, t, m)).to be_within(1e-12).of pr.p_gt(t)
+          end
+        end
+      end
+
+      it 'should answer queries on pools too large for a full distribution' do
+        p_mid = GamesDice::Probabilities.fair_dice_p_eql(1_000_000, 6, 3_500_000)
+        expect(p_mid).to be_within(1e-8).of 2.336e-4
+        p_ge = GamesDice::Probabilities.fair_dice_p_ge(1_000_000, 6, 3_500_000)
+        expect(p_ge).to be_within(1e-12).of 0.5 + (p_mid / 2)
+      end
+
+      it 'should raise an error if params are unexpected' do
+        expect(-> { GamesDice::Probabilities.fair_dice_p_eql({}, 6, 3) }).to raise_error TypeError
+        expect(-> { GamesDice::Probabilities.fair_dice_p_le(3, 6, 'x') }).to raise_error TypeError
+        expect(-> { GamesDice::Probabilities.fair_dice_p_ge(0, 6, 3) }).to raise_error ArgumentError
+        expect(-> { GamesDice::Probabilities.fair_dice_p_gt(3, 0, 3) }).to raise_error ArgumentError
+        expect(-> { GamesDice::Probabilities.fair_dice_p_lt(3, 6, 3, 0) }).to raise_error ArgumentError
       end
     end
   end
@@ -263,6 +437,14 @@ describe GamesDice::Probabilities do
         expect(pr10.p_ge(-200)).to eql 1.0
       end
 
+      it 'should keep full relative precision for small upper tails' do
+        pr10d10 = GamesDice::Probabilities.for_fair_die(10).repeat_sum(10)
+        # Counts of ways to roll 95+ and 100 on 10d10 are 2002 + 715 + 220 + 55 + 10 + 1 and 1
+        expect(pr10d10.p_ge(95)).to be_within(3003e-10 * 1e-12).of 3003e-10
+        expect(pr10d10.p_gt(99)).to be_within(1e-10 * 1e-12).of 1e-10
+        expect(pr10d10.p_ge(101)).to eql 0.0
+      end
+
       it 'should raise a TypeError if asked for probability of non-Integer' do
         expect(-> { pr4.p_ge({}) }).to raise_error TypeError
       end
@@ -375,6 +557,23 @@ describe GamesDice::Probabilities do
       it 'should raise a TypeError if asked for probability of non-Integer' do
         expect(-> { pr10.given_ge([]) }).to raise_error TypeError
       end
+
+      it 'should share probabilities with the original distribution' do
+        pd = pr10.repeat_sum(3).given_ge(20)
+        expect(pd.storage_mode).to eql :view
+        GC.start
+        expect(pd.p_ge(25)).to be_within(1e-12).of pr10.repeat_sum(3).p_ge(25) / pr10.repeat_sum(3).p_ge(20)
+        expect(pd.given_le(25).to_h).to be_valid_distribution
+        expect(GamesDice::Probabilities.add_distributions(pd, pr10).storage_mode).to eql :double
+        expect(pd.expand.to_h.keys).to eql pd.to_h.keys
+      end
+
+      it 'should keep full precision in lower tails' do
+        view = GamesDice::Probabilities.for_fair_die(6).repeat_sum(100).given_ge(101)
+        copy = view.expand
+        expect(view.p_lt(110) / copy.p_lt(110)).to be_within(1e-12).of 1.0
+        expect(view.p_le(101) / copy.p_le(101)).to be_within(1e-12).of 1.0
+      end
     end
 
     describe '#given_le' do
@@ -390,6 +589,16 @@ describe GamesDice::Probabilities do
       it 'should raise a TypeError if asked for probability of non-Integer' do
         expect(-> { pr10.given_le({}) }).to raise_error TypeError
       end
+
+      it 'should keep full precision in upper tails' do
+        view = GamesDice::Probabilities.for_fair_die(6).repeat_sum(100).given_le(599)
+        copy = view.expand
+        expect(view.p_gt(590) / copy.p_gt(590)).to be_within(1e-12).of 1.0
+        view = pr10.repeat_sum(10).given_le(99)
+        copy = view.expand
+        expect(view.p_ge(95) / copy.p_ge(95)).to be_within(1e-12).of 1.0
+        expect(view.p_gt(90) / copy.p_gt(90)).to be_within(1e-12).of 1.0
+      end
     end
 
     describe '#repeat_sum' do
@@ -412,6 +621,22 @@ describe GamesDice::Probabilities do
         expect(-> { d1000.repeat_sum(11_000) }).to raise_error(RuntimeError, /Too many probability slots/)
       end
 
+      it 'should give the same results when sweeping n on one distribution' do
+        d6 = GamesDice::Probabilities.for_fair_die(6)
+        d10 = GamesDice::Probabilities.new([0.05, 0.05, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.15, 0.15], 1)
+        [d6, d10].each do |pd|
+          (1..40).each do |n|
+            expected = pd.clone.repeat_sum(n).to_h
+            pd.repeat_sum(n).to_h.each do |result, p|
+              expect(p).to be_within(1e-15).of expected[result]
+            end
+          end
+          [37, 16, 1, 33].each do |n|
+            expect(pd.repeat_sum(n).to_h).to eql pd.clone.repeat_sum(n).to_h
+          end
+        end
+      end
+
       it "should calculate a '3d6' distribution accurately" do
         d6 = GamesDice::Probabilities.for_fair_die(6)
         pr = d6.repeat_sum(3)
@@ -436,6 +661,110 @@ describe GamesDice::Probabilities do
       end
     end
 
+    describe '#compact, #expand and #storage_mode' do
+      let(:pr10x10) { pr10.repeat_sum(10) }
+
+      it 'should default to :float32 and keep results within documented error' do
+        pd = pr10x10.compact
+        expect(pr10x10.storage_mode).to eql :double
+        expect(pd.storage_mode).to eql :float32
+        expect(pd.min).to eql 10
+        expect(pd.max).to eql 100
+        (10..100).each do |t|
+          expect(pd.p_eql(t)).to be_within(pr10x10.p_eql(t) * 6e-8).of pr10x10.p_eql(t)
+          expect(pd.p_ge(t)).to be_within(pr10x10.p_ge(t) * 6e-8).of pr10x10.p_ge(t)
+          expect(pd.p_lt(t)).to be_within(pr10x10.p_lt(t) * 6e-8).of pr10x10.p_lt(t)
+        end
+        expect(pd.expected).to be_within(1e-6).of 55.0
+      end
+
+      it 'should quantize to :q16 within documented error' do
+        pd = pr10x10.compact(:q16)
+        expect(pd.storage_mode).to eql :q16
+        bound = pr10x10.p_eql(55) / 131_070
+        (10..100).each do |t|
+          expect(pd.p_eql(t)).to be_within(bound).of pr10x10.p_eql(t)
+        end
+        expect(pd.p_ge(10)).to eql 1.0
+        expect(pd.p_gt(100)).to eql 0.0
+      end
+
+      it 'should calculate new distributions in double precision' do
+        pd = pr10x10.compact(:q16)
+        expect(pd.repeat_sum(2).storage_mode).to eql :double
+        expect(pd.repeat_sum(2).max).to eql 200
+        sum = GamesDice::Probabilities.add_distributions(pd, pr6)
+        expect(sum.storage_mode).to eql :double
+        expect(sum.min).to eql 11
+        expect(pd.given_ge(90).to_h).to be_valid_distribution
+        expect(pd.sampler.sample(100, 1).all? { |r| r.between?(10, 100) }).to be true
+      end
+
+      it 'should convert between modes and copy' do
+        pd = pr10x10.compact(:float32)
+        expect(pd.clone.storage_mode).to eql :float32
+        expect(pd.clone.p_eql(55)).to eql pd.p_eql(55)
+        expect(pd.expand.storage_mode).to eql :double
+        expect(pd.expand.p_le(55)).to be_within(1e-7).of pr10x10.p_le(55)
+        expect(pd.compact(:double).storage_mode).to eql :double
+        yielded = []
+        pd.each { |r, p| yielded << [r, p] }
+        expect(yielded.size).to eql 91
+        expect(pd.to_h.keys.size).to eql 91
+      end
+
+      it 'should use less memory' do
+        require 'objspace'
+        big = GamesDice::Probabilities.for_fair_die(1000).repeat_sum(10)
+        expect(ObjectSpace.memsize_of(big.compact(:float32)) * 3).to be < ObjectSpace.memsize_of(big)
+        expect(ObjectSpace.memsize_of(big.compact(:q16)) * 6).to be < ObjectSpace.memsize_of(big)
+      end
+
+      it 'should raise an error for unknown modes' do
+        expect(-> { pr10.compact(:float16) }).to raise_error ArgumentError
+        expect(-> { pr10.compact('q16') }).to raise_error ArgumentError
+      end
+    end
+
+    describe '#hash, #eql? and #==' do
+      it 'should be equal for distributions with the same content' do
+        other6 = GamesDice::Probabilities.new([1.0 / 6] * 6, 1)
+        expect(pr6.eql?(other6)).to be true
+        expect(pr6 == other6).to be true
+        expect(pr6.hash).to eql other6.hash
+        expect({ pr6 => :d6 }[other6]).to eql :d6
+      end
+
+      it 'should differ for different results or probabilities' do
+        expect(pr6.eql?(pr4)).to be false
+        expect(pr6.eql?(GamesDice::Probabilities.new([1.0 / 6] * 6, 0))).to be false
+        expect(pra.eql?(GamesDice::Probabilities.new([0.4, 0.2, 0.4], -1))).to be true
+        expect(pra.eql?(GamesDice::Probabilities.new([0.3, 0.2, 0.5], -1))).to be false
+        expect(pr6 == pr6.to_h).to be false
+      end
+
+      it 'should compare probabilities regardless of storage' do
+        pr = pr10.repeat_sum(3)
+        view = pr.given_ge(12)
+        expect(view.eql?(view.expand)).to be true
+        expect(view.hash).to eql view.expand.hash
+        expect(pr.eql?(pr.compact(:float32))).to be false
+      end
+
+      it 'should ignore stride and zero padding' do
+        padded = GamesDice::Probabilities.new([0.5, 0.0, 0.5], 0)
+        strided = GamesDice::Probabilities.from_h(padded.to_h)
+        expect(padded.eql?(strided)).to be true
+        expect(padded.hash).to eql strided.hash
+        expect(GamesDice::Probabilities.intern(padded)).to be GamesDice::Probabilities.intern(strided)
+
+        mult = GamesDice::Probabilities.add_distributions_mult(2, pr2, 0, pr2)
+        expect(mult == GamesDice::Probabilities.new([0.5, 0.0, 0.5], 2)).to be true
+        expect(mult.hash).to eql GamesDice::Probabilities.new([0.5, 0.0, 0.5], 2).hash
+        expect(mult == GamesDice::Probabilities.new([0.5, 0.0, 0.5], 1)).to be false
+      end
+    end
+
     describe '#repeat_n_sum_k' do
       it 'should output a valid distribution if params are valid' do
         d4a = GamesDice::Probabilities.new([1.0 / 4, 1.0 / 4, 1.0 / 4, 1.0 / 4], 1)
@@ -509,6 +838,86 @@ describe GamesDice::Probabilities do
     end
   end
 
+  describe 'memory use' do
+    it 'should report native allocations to ObjectSpace.memsize_of' do
+      require 'objspace'
+      pd = GamesDice::Probabilities.for_fair_die(1000)
+      expect(ObjectSpace.memsize_of(pd)).to be > 1000 * 16
+      big = pd.repeat_sum(100)
+      expect(ObjectSpace.memsize_of(big)).to be > 99_901 * 16
+    end
+
+    it 'should include lazily-built arrays and cached powers' do
+      require 'objspace'
+      pd = GamesDice::Probabilities.new(Array.new(1000, 0.001), 1)
+      before = ObjectSpace.memsize_of(pd)
+      pd.repeat_sum(64)
+      expect(ObjectSpace.memsize_of(pd)).to be > before + 63_937 * 8
+    end
+
+    it 'should cache powers passed while summing fair dice' do
+      require 'objspace'
+      pd = GamesDice::Probabilities.for_fair_die(1000)
+      before = ObjectSpace.memsize_of(pd)
+      pd.repeat_sum(40)
+      expect(ObjectSpace.memsize_of(pd)).to be > before + 31_969 * 8
+      expect(pd.repeat_sum(40).p_eql(20_019)).to be_within(1e-15).of pd.repeat_sum(40).p_eql(20_021)
+    end
+
+    it 'should not copy probabilities for given_ge and given_le' do
+      require 'objspace'
+      pd = GamesDice::Probabilities.for_fair_die(100_000)
+      expect(ObjectSpace.memsize_of(pd.given_ge(10))).to be < 1000
+      expect(ObjectSpace.memsize_of(pd.given_le(99_990))).to be < 1000
+    end
+  end
+
+  describe 'interning' do
+    after :each do
+      GamesDice::Probabilities.interning = false
+    end
+
+    it 'should return one frozen instance for identical content' do
+      pr = GamesDice::Probabilities.intern(GamesDice::Probabilities.for_fair_die(6))
+      expect(pr.frozen?).to be true
+      expect(GamesDice::Probabilities.intern(GamesDice::Probabilities.for_fair_die(6))).to be pr
+      expect(GamesDice::Probabilities.intern(GamesDice::Probabilities.for_fair_die(8))).to_not be pr
+      expect(pr.repeat_sum(2).p_eql(7)).to be_within(1e-15).of 1.0 / 6
+    end
+
+    it 'should not freeze the distribution it was given' do
+      pr = GamesDice::Probabilities.for_fair_die(12)
+      expect(GamesDice::Probabilities.intern(pr).frozen?).to be true
+      expect(pr.frozen?).to be false
+    end
+
+    it 'should not freeze the distribution given to dice objects' do
+      GamesDice::Probabilities.interning = true
+      pr = GamesDice::Probabilities.for_fair_die(14)
+      expect(GamesDice::Probabilities.canonical(pr).frozen?).to be true
+      expect(pr.frozen?).to be false
+    end
+
+    it 'should return the same instance to threads interning at the same time' do
+      found = Array.new(8) { Thread.new { GamesDice::Probabilities.intern(GamesDice::Probabilities.for_fair_die(15)) } }
+      found = found.map(&:value)
+      expect(found.uniq(&:object_id).size).to eql 1
+    end
+
+    it 'should share probabilities between dice objects only when enabled' do
+      expect(GamesDice::Probabilities.interning?).to be false
+      pr = GamesDice::Bunch.new(ndice: 3, sides: 6).probabilities
+      expect(GamesDice::Bunch.new(ndice: 3, sides: 6).probabilities).to_not be pr
+
+      GamesDice::Probabilities.interning = true
+      pr = GamesDice::Bunch.new(ndice: 3, sides: 6).probabilities
+      expect(pr.frozen?).to be true
+      expect(GamesDice::Bunch.new(ndice: 3, sides: 6).probabilities).to be pr
+      expect(GamesDice::Dice.new([{ ndice: 3, sides: 6 }], 0).probabilities).to be pr
+      expect(GamesDice::Die.new(6).probabilities).to be GamesDice::ComplexDie.new(6).probabilities
+    end
+  end
+
   describe 'serialisation via Marshall' do
     it 'can load a saved GamesDice::Probabilities' do
       # rubocop:disable Security/MarshalLoad
@@ -0,0 +1,124 @@
+# frozen_string_literal: true
+
+require 'helpers'
+
+describe GamesDice::Probabilities::Sampler do
+  let(:pr6) { GamesDice::Probabilities.for_fair_die(6) }
+  let(:pr4d6k3) { GamesDice::Probabilities.for_fair_die(6).repeat_n_sum_k(4, 3) }
+
+  describe '#new' do
+    it 'should create a sampler from a distribution' do
+      sampler = GamesDice::Probabilities::Sampler.new(pr6)
+      expect(sampler).to be_a GamesDice::Probabilities::Sampler
+      expect(sampler.probabilities).to be pr6
+      expect(sampler.min).to eql 1
+      expect(sampler.max).to eql 6
+    end
+
+    it 'should raise an error if not given a GamesDice::Probabilities object' do
+      expect(-> { GamesDice::Probabilities::Sampler.new('') }).to raise_error TypeError
+      expect(-> { GamesDice::Probabilities::Sampler.new(6) }).to raise_error TypeError
+    end
+
+    it 'should replace its alias table when initialized again' do
+      sampler = GamesDice::Probabilities::Sampler.new(pr6)
+      sampler.send(:initialize, pr4d6k3)
+      expect(sampler.probabilities).to be pr4d6k3
+      expect(sampler.min).to eql 3
+      expect(sampler.max).to eql 18
+      expect(sampler.histogram(1000, 3)).to eql GamesDice::Probabilities::Sampler.new(pr4d6k3).histogram(1000, 3)
+    end
+  end
+
+  describe 'memory use' do
+    it 'should report alias table size to ObjectSpace.memsize_of' do
+      require 'objspace'
+      sampler = GamesDice::Probabilities.for_fair_die(10_000).sampler
+      expect(ObjectSpace.memsize_of(sampler)).to be > 10_000 * 12
+    end
+
+    it 'should keep its distribution through garbage collection and compaction' do
+      sampler = GamesDice::Probabilities.for_fair_die(6).repeat_sum(2).sampler
+      GC.start
+      GC.compact if GC.respond_to?(:compact)
+      expect(sampler.probabilities.min).to eql 2
+      expect(sampler.probabilities.p_eql(7)).to be_within(1e-10).of 1.0 / 6
+    end
+  end
+
+  describe 'GamesDice::Probabilities#sampler' do
+    it 'should create a sampler for the distribution' do
+      sampler = pr4d6k3.sampler
+      expect(sampler).to be_a GamesDice::Probabilities::Sampler
+      expect(sampler.min).to eql 3
+      expect(sampler.max).to eql 18
+    end
+  end
+
+  describe '#sample' do
+    it 'should return results within the distribution' do
+      results = pr4d6k3.sampler.sample(1000, 3579)
+      expect(results.count).to eql 1000
+      results.each { |r| expect(r).to be_a Integer }
+      expect(results.min).to be >= 3
+      expect(results.max).to be <= 18
+    end
+
+    it 'should be repeatable given an Integer seed' do
+      sampler = pr4d6k3.sampler
+      expect(sampler.sample(20, 123)).to eql sampler.sample(20, 123)
+    end
+
+    it "should use Ruby's internal rand() to seed by default" do
+      sampler = pr4d6k3.sampler
+      srand(4567)
+      first = sampler.sample(20)
+      srand(4567)
+      expect(sampler.sample(20)).to eql first
+    end
+
+    it 'should accept any object with a rand(Integer) method as the second param' do
+      results = pr6.sampler.sample(3, TestPRNGMax.new)
+      expect(results).to eql [6, 6, 6]
+    end
+
+    it 'should never return results with zero probability' do
+      pr_plus_minus = GamesDice::Probabilities.new([0.5, 0.0, 0.5], -1)
+      expect(pr_plus_minus.sampler.sample(1000, 17).uniq.sort).to eql [-1, 1]
+    end
+
+    it 'should raise an error if params are unexpected' do
+      sampler = pr6.sampler
+      expect(-> { sampler.sample(-1) }).to raise_error ArgumentError
+      expect(-> { sampler.sample({}) }).to raise_error TypeError
+      expect(-> { sampler.sample(10, 'x') }).to raise_error TypeError
+    end
+  end
+
+  describe '#histogram' do
+    it 'should count results in proportion to the distribution' do
+      h = pr4d6k3.sampler.histogram(200_000, 2468)
+      expect(h.values.inject(:+)).to eql 200_000
+      h.each do |result, count|
+        expect(count / 200_000.0).to be_within(0.005).of pr4d6k3.p_eql(result)
+      end
+    end
+
+    it 'should count results in proportion for compact storage and views' do
+      [pr4d6k3.compact(:q16), pr4d6k3.given_ge(10)].each do |pd|
+        h = pd.sampler.histogram(200_000, 1357)
+        total = pd.to_h.values.inject(:+)
+        h.each do |result, count|
+          expect(count / 200_000.0).to be_within(0.005).of pd.p_eql(result) / total
+        end
+      end
+    end
+
+    it 'should match #sample for the same seed' do
+      sampler = pr4d6k3.sampler
+      counts = Hash.new(0)
+      sampler.sample(500, 99).each { |r| counts[r] += 1 }
+      expect(sampler.histogram(500, 99)).to eql counts
+    end
+  end
+end